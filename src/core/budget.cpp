@@ -0,0 +1,52 @@
+#include "budget.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+int StepBudget::schedule(int steps, double& delta) {
+	m_frames++;
+	if (steps <= 0 || delta <= 0.0) return steps;
+
+	// the backlog is paid back in steps of this frame's length, rounded up so no step gets longer
+	double stepDelta = delta / steps;
+	double wantedDelta = delta + m_backlog;
+	double owedSteps = std::ceil(m_backlog / stepDelta - 1e-6);
+	int wanted = steps + static_cast<int>(std::min<double>(owedSteps, INT_MAX - steps));
+
+	int cap = INT_MAX;
+	if (active() && m_costPerStep > 0.0) {
+		cap = std::max(1, static_cast<int>(std::min<double>(m_budget / m_costPerStep, INT_MAX)));
+	}
+
+	if (wanted <= cap) {
+		m_backlog = 0.0;
+		delta = wantedDelta;
+		return wanted;
+	}
+
+	m_budgetHits++;
+	delta = cap * stepDelta;
+	m_backlog = wantedDelta - delta;
+	if (m_backlog > MAX_BACKLOG) {
+		m_droppedTime += m_backlog - MAX_BACKLOG;
+		m_backlog = MAX_BACKLOG;
+	}
+	m_maxBacklog = std::max(m_maxBacklog, m_backlog);
+
+	return cap;
+}
+
+void StepBudget::recordCost(double seconds, int steps) {
+	if (steps <= 0 || seconds <= 0.0) return;
+
+	double sample = seconds / steps;
+	m_costPerStep = m_costPerStep == 0.0 ? sample : (0.1 * sample) + (0.9 * m_costPerStep);
+}
+
+void StepBudget::resetCounters() {
+	m_frames = 0;
+	m_budgetHits = 0;
+	m_droppedTime = 0.0;
+	m_maxBacklog = 0.0;
+}
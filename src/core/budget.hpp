@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+caps how many physics steps run in one frame, based on how long a step has actually been taking
+the time that doesn't fit is carried over and simulated in later frames, so a hitch doesn't make the next frame late too
+steps never get longer than the frame's own, a capped frame simulates less time instead
+*/
+class StepBudget {
+public:
+	static constexpr double MAX_BACKLOG = 1.0; // s, anything past this is dropped
+
+	void setBudget(double seconds) { m_budget = seconds; } // 0 -> unlimited
+	bool active() const { return m_budget > 0.0; }
+
+	/*
+	steps to run this frame, out of `steps` over `delta` wanted plus whatever time is still owed
+	`delta` is updated to the time those steps should simulate
+	*/
+	int schedule(int steps, double& delta);
+
+	// how long the frame's physics steps took, to update the cost estimate
+	void recordCost(double seconds, int steps);
+
+	// drop the backlog, e.g. after a death or when the level restarts
+	void clearBacklog() { m_backlog = 0.0; }
+	void resetCounters();
+
+	double backlog() const { return m_backlog; } // s
+	double costPerStep() const { return m_costPerStep; }
+	uint64_t frames() const { return m_frames; }
+	uint64_t budgetHits() const { return m_budgetHits; } // frames where the cap was reached
+	double droppedTime() const { return m_droppedTime; } // s that overflowed MAX_BACKLOG
+	double maxBacklog() const { return m_maxBacklog; }
+
+private:
+	double m_budget = 0.0;
+	double m_costPerStep = 0.0; // s, moving average
+	double m_backlog = 0.0; // s
+
+	uint64_t m_frames = 0;
+	uint64_t m_budgetHits = 0;
+	double m_droppedTime = 0.0;
+	double m_maxBacklog = 0.0;
+};
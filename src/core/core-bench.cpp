@@ -0,0 +1,237 @@
+/*
+microbenchmark for the step schedule, runs on any platform without Geode
+builds a frame's schedule from N evenly spread inputs and walks it the way the PlayerObject::update hook does
+also replays a jittery frame time sequence through each physics bypass predictor,
+and times LinuxBinds::translate against the set lookups it replaced
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "steps.hpp"
+#include "pacing.hpp"
+#include "linuxbinds.hpp"
+
+// ns, like Android and macOS
+constexpr TimestampType FRAME_START = 1'000'000'000'000;
+constexpr TimestampType FRAME_LENGTH = 1'000'000'000 / 60;
+
+struct Result {
+	double buildNs; // per frame
+	double walkNs; // per frame
+	size_t substeps;
+};
+
+Result run(int inputCount, int stepCount, double seconds) {
+	RingQueue<StepInput> inputs;
+	StepQueue queue;
+	float checksum = 0.0f;
+
+	using clock = std::chrono::steady_clock;
+	clock::duration buildTime{}, walkTime{};
+	size_t frames = 0, substeps = 0;
+
+	auto end = clock::now() + std::chrono::duration<double>(seconds);
+	while (clock::now() < end) {
+		inputs.clear();
+		for (int i = 0; i < inputCount; i++) {
+			TimestampType t = FRAME_START + (FRAME_LENGTH * (2 * i + 1)) / (2 * inputCount);
+			inputs.emplace_back(StepInput{ t, InputJump, (i & 1) == 0, false });
+		}
+
+		auto start = clock::now();
+		queue.build(inputs, FRAME_START, FRAME_START + FRAME_LENGTH, stepCount);
+		auto built = clock::now();
+
+		for (int i = 0; i < stepCount; i++) {
+			if (!queue.inputThisStep()) {
+				queue.skipStep();
+				continue;
+			}
+			Step input, step;
+			do {
+				step = queue.pop(input);
+				checksum += step.deltaFactor;
+				substeps++;
+			} while (!step.endStep);
+		}
+		auto walked = clock::now();
+
+		buildTime += built - start;
+		walkTime += walked - built;
+		frames++;
+	}
+
+	if (checksum < 0.0f) std::printf("impossible\n"); // keep the walk from being optimized out
+
+	auto perFrame = [&](clock::duration d) { return std::chrono::duration<double, std::nano>(d).count() / frames; };
+	return Result{ perFrame(buildTime), perFrame(walkTime), substeps / frames };
+}
+
+// 144hz cap but only reaching ~100fps under load, with VRR jitter and the occasional hitch
+void comparePacing() {
+	EmaPredictor ema;
+	PercentilePredictor percentile;
+	HysteresisPredictor hysteresis;
+	PacingPredictor* predictors[] = { &ema, &percentile, &hysteresis };
+
+	std::printf("\n%12s %10s %10s %10s %10s\n", "predictor", "mean", "variance", "changes", "catch-ups");
+	for (PacingPredictor* predictor : predictors) {
+		std::mt19937 rng(42);
+		std::normal_distribution<double> jitter(0.0, 0.001);
+		std::uniform_real_distribution<double> hitch(0.0, 1.0);
+		PacingStats stats;
+
+		for (int frame = 0; frame < 100000; frame++) {
+			double delta = 1.0 / 100.0 + jitter(rng);
+			if (hitch(rng) < 0.01) delta += 0.008;
+			computeStepCount(delta, 1.0f, BypassMode::Predicted, 1.0 / 144.0, *predictor, &stats);
+		}
+		std::printf("%12s %10.3f %10.3f %10llu %10llu\n", predictor->name(), stats.mean(), stats.variance(),
+			static_cast<unsigned long long>(stats.changes()), static_cast<unsigned long long>(stats.catchUps()));
+	}
+}
+
+/*
+how linuxCheckInputs translated events before the binds were compiled: a map from scancode/button to key code
+(standing in for MapVirtualKeyExA), then each action's bind set in turn, and a set of held controller buttons
+*/
+struct SetBinds {
+	std::array<std::unordered_set<size_t>, 6> binds;
+	std::unordered_map<int, size_t> scanCodes;
+	std::unordered_map<int, size_t> buttons;
+	std::unordered_set<size_t> held;
+
+	bool translate(const LinuxInputEvent& ev, StepInput& input) {
+		if (ev.type != EV_KEY) return false;
+
+		size_t keyCode;
+		if (ev.deviceType == MOUSE) {
+			if (ev.code != BUTTON_LEFT) return false;
+			input.button = InputJump;
+			input.isPlayer2 = false;
+			input.isPush = ev.value != 0;
+			return true;
+		}
+		else if (ev.deviceType == KEYBOARD) keyCode = scanCodes[ev.code];
+		else if (ev.deviceType == CONTROLLER) {
+			keyCode = buttons[ev.code];
+			if (ev.value) {
+				if (held.contains(keyCode)) return false;
+				held.emplace(keyCode);
+			}
+			else {
+				if (!held.contains(keyCode)) return false;
+				held.erase(keyCode);
+			}
+		}
+		else return false;
+
+		int action = -1;
+		for (int i = 0; i < 6 && action < 0; i++) {
+			if (binds[i].contains(keyCode)) action = i;
+		}
+		if (action < 0) return false;
+
+		input.button = action % 3 == p1Jump ? InputJump : action % 3 == p1Left ? InputLeft : InputRight;
+		input.isPlayer2 = action >= p2Jump;
+		input.isPush = ev.value != 0;
+		return true;
+	}
+};
+
+// a keyboard/mouse/controller mix, ~half of the keys unbound, like a player mashing next to their binds
+void compareTranslate(double seconds) {
+	std::array<std::unordered_set<size_t>, 6> binds;
+	binds[p1Jump] = { 0x20, 0x57, 0x3E9, 0x3EF }; // space, w, controller a, controller up
+	binds[p1Left] = { 0x41, 0x3F1 };
+	binds[p1Right] = { 0x44, 0x3F2 };
+	binds[p2Jump] = { 0x26, 0x3ED };
+	binds[p2Left] = { 0x25 };
+	binds[p2Right] = { 0x27 };
+
+	// scancode -> virtual key, US layout
+	const std::pair<int, size_t> keys[] = {
+		{ 0x39, 0x20 }, { 0x11, 0x57 }, { 0x1E, 0x41 }, { 0x20, 0x44 }, { 0xE048, 0x26 }, { 0xE04B, 0x25 }, { 0xE04D, 0x27 },
+		{ 0x10, 0x51 }, { 0x12, 0x45 }, { 0x13, 0x52 }, { 0x1F, 0x53 }, { 0x2A, 0xA0 }, { 0x1D, 0xA2 }, { 0x0F, 0x09 },
+	};
+	const std::pair<int, size_t> buttons[] = { { BTN_A, 0x3E9 }, { BTN_B, 0x3EA }, { BTN_TL, 0x3ED }, { BTN_START, 0x3F0 } };
+
+	SetBinds sets;
+	sets.binds = binds;
+	LinuxBinds compiled;
+	compiled.compileActions(binds);
+	for (auto [code, keyCode] : keys) {
+		sets.scanCodes[code] = keyCode;
+		compiled.scanCodeActions[shm_code_index(code)] = compiled.actionFor(keyCode);
+	}
+	for (auto [code, keyCode] : buttons) {
+		sets.buttons[code] = keyCode;
+		compiled.buttonKeys[code] = static_cast<int16_t>(keyCode);
+	}
+
+	std::vector<LinuxInputEvent> events(4096);
+	std::mt19937 rng(5);
+	for (size_t i = 0; i < events.size(); i++) {
+		LinuxInputEvent& ev = events[i];
+		ev.type = EV_KEY;
+		ev.value = (i / 3) & 1;
+		switch (rng() % 3) {
+		case 0:
+			ev.deviceType = MOUSE;
+			ev.code = BUTTON_LEFT;
+			break;
+		case 1:
+			ev.deviceType = KEYBOARD;
+			ev.code = static_cast<uint16_t>(keys[rng() % std::size(keys)].first);
+			break;
+		default:
+			ev.deviceType = CONTROLLER;
+			ev.code = static_cast<uint16_t>(buttons[rng() % std::size(buttons)].first);
+		}
+	}
+
+	auto time = [&](auto& binds) {
+		using clock = std::chrono::steady_clock;
+		size_t translated = 0, count = 0;
+		StepInput input{};
+		auto start = clock::now();
+		auto end = start + std::chrono::duration<double>(seconds);
+		while (clock::now() < end) {
+			for (const LinuxInputEvent& ev : events) translated += binds.translate(ev, input);
+			count += events.size();
+		}
+		double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / count;
+		return std::pair{ ns, static_cast<double>(translated) / count };
+	};
+
+	auto [setNs, setRate] = time(sets);
+	auto [compiledNs, compiledRate] = time(compiled);
+	std::printf("\n%12s %10s %10s\n", "translate", "ns/event", "used");
+	std::printf("%12s %10.2f %10.3f\n", "sets", setNs, setRate);
+	std::printf("%12s %10.2f %10.3f\n", "compiled", compiledNs, compiledRate);
+}
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? std::atof(argv[1]) : 0.2; // per configuration
+
+	const int inputCounts[] = { 1, 10, 100, 1000, 10000 };
+	const int stepCounts[] = { 1, 4, 16, 240, 1000, 4000 };
+
+	std::printf("%8s %8s %12s %12s %12s %10s\n", "inputs", "steps", "build ns", "walk ns", "ns/input", "substeps");
+	for (int inputCount : inputCounts) {
+		for (int stepCount : stepCounts) {
+			Result r = run(inputCount, stepCount, seconds);
+			std::printf("%8d %8d %12.0f %12.0f %12.1f %10zu\n",
+				inputCount, stepCount, r.buildNs, r.walkNs, (r.buildNs + r.walkNs) / inputCount, r.substeps);
+		}
+	}
+
+	comparePacing();
+	compareTranslate(seconds * 5);
+	return 0;
+}
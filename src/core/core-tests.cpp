@@ -0,0 +1,524 @@
+/*
+unit tests for cbf-core, runs on any platform without Geode
+registered with ctest, exits non-zero if any check fails
+*/
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "steps.hpp"
+#include "pacing.hpp"
+#include "budget.hpp"
+#include "linuxbinds.hpp"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond) do { \
+	checks++; \
+	if (!(cond)) { \
+		std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+// every allocation in the process goes through here so the tests can check the hot path doesn't make any
+static std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+struct Walked {
+	uint32_t index;
+	float deltaFactor;
+	bool endStep;
+	bool fired; // an input was handed out when this substep was popped
+	uint8_t button;
+	bool isPush;
+};
+
+// pop every substep of a frame the way the PlayerObject::update hook does
+std::vector<Walked> walk(StepQueue& queue, int stepCount) {
+	std::vector<Walked> out;
+	for (int i = 0; i < stepCount; i++) {
+		if (!queue.inputThisStep()) {
+			queue.skipStep();
+			out.push_back(Walked{ static_cast<uint32_t>(i), 1.0f, true, false, 0, false });
+			continue;
+		}
+		Step input, step;
+		do {
+			step = queue.pop(input);
+			out.push_back(Walked{ step.index, step.deltaFactor, step.endStep, !input.endStep, input.button, input.isPush });
+		} while (!step.endStep);
+	}
+	return out;
+}
+
+/*
+the schedule buildStepQueue made before it moved into cbf-core: every step gets an end entry,
+and step positions come from floating point division of the frame
+*/
+std::vector<Walked> baseline(const std::vector<TimestampType>& timestamps, TimestampType frameStart, TimestampType frameEnd, int stepCount) {
+	std::vector<Walked> out;
+	double stepDelta = static_cast<double>(frameEnd - frameStart) / stepCount;
+	size_t inputIdx = 0;
+	for (int i = 0; i < stepCount; i++) {
+		double elapsedTime = 0.0;
+		while (inputIdx < timestamps.size()) {
+			double elapsed = static_cast<double>(timestamps[inputIdx] - frameStart);
+			if (elapsed >= stepDelta * (i + 1)) break;
+			double inputTime = std::fmod(elapsed, stepDelta) / stepDelta;
+			out.push_back(Walked{ static_cast<uint32_t>(i), static_cast<float>(std::clamp(inputTime - elapsedTime, SMALLEST_FLOAT, 1.0)), false, false, 0, false });
+			elapsedTime = inputTime;
+			inputIdx++;
+		}
+		out.push_back(Walked{ static_cast<uint32_t>(i), static_cast<float>(std::max(SMALLEST_FLOAT, 1.0 - elapsedTime)), true, false, 0, false });
+	}
+	return out;
+}
+
+void testStepPlacement() {
+	std::mt19937_64 rng(1);
+	RingQueue<StepInput> inputs;
+	StepQueue queue;
+	int mismatches = 0;
+
+	for (int frame = 0; frame < 5000; frame++) {
+		int stepCount = 1 + rng() % 300;
+		TimestampType frameStart = rng() % 1'000'000'000'000LL;
+		TimestampType length = 1 + rng() % 50'000'000;
+		int inputCount = rng() % 40;
+
+		std::vector<TimestampType> timestamps;
+		for (int i = 0; i < inputCount; i++) timestamps.push_back(frameStart + static_cast<TimestampType>(rng() % length));
+		std::sort(timestamps.begin(), timestamps.end());
+
+		inputs.clear();
+		for (TimestampType t : timestamps) inputs.emplace_back(StepInput{ t, InputJump, true, false });
+
+		size_t used = queue.build(inputs, frameStart, frameStart + length, stepCount);
+		std::vector<Walked> got = walk(queue, stepCount);
+		std::vector<Walked> expected = baseline(timestamps, frameStart, frameStart + length, stepCount);
+
+		bool same = used == timestamps.size() && got.size() == expected.size();
+		for (size_t i = 0; same && i < got.size(); i++) {
+			same = got[i].index == expected[i].index
+				&& got[i].endStep == expected[i].endStep
+				&& std::fabs(got[i].deltaFactor - expected[i].deltaFactor) < 1e-4;
+		}
+		if (!same) mismatches++;
+	}
+	CHECK(mismatches == 0);
+
+	// inputs after the end of the frame stay in the ring for the next one
+	inputs.clear();
+	inputs.emplace_back(StepInput{ 100, InputJump, true, false });
+	inputs.emplace_back(StepInput{ 400, InputJump, false, false });
+	CHECK(queue.build(inputs, 0, 400, 4) == 1);
+
+	// nothing to split
+	CHECK(queue.build(inputs, 400, 400, 4) == 0);
+	CHECK(queue.empty());
+}
+
+void testCoalescing() {
+	RingQueue<StepInput> inputs;
+	inputs.emplace_back(StepInput{ 110, InputJump, true, false });
+	inputs.emplace_back(StepInput{ 111, InputJump, true, false }); // same press again, dropped
+	inputs.emplace_back(StepInput{ 112, InputJump, false, false }); // shares the first press's substep
+	inputs.emplace_back(StepInput{ 150, InputJump, true, false });
+
+	StepQueue queue;
+	queue.setMinSubstep(0.05);
+	CHECK(queue.build(inputs, 0, 400, 4) == 4);
+	CHECK(queue.saved() == 2);
+
+	std::vector<Walked> got = walk(queue, 4);
+	float total = 0.0f;
+	int fired = 0;
+	for (const Walked& w : got) {
+		total += w.deltaFactor;
+		fired += w.fired;
+	}
+	CHECK(std::fabs(total - 4.0f) < 1e-5);
+	CHECK(fired == 3);
+
+	// the release fires right after the press, with no physics in between
+	CHECK(got.size() == 7);
+	CHECK(got[2].deltaFactor == 0.0f && got[2].fired && got[2].isPush);
+	CHECK(got[3].fired && !got[3].isPush);
+
+	// off by default
+	StepQueue plain;
+	plain.build(inputs, 0, 400, 4);
+	CHECK(plain.saved() == 0);
+}
+
+void testSplice() {
+	RingQueue<StepInput> inputs;
+	inputs.emplace_back(StepInput{ 250, InputJump, true, false });
+	inputs.emplace_back(StepInput{ 450, InputJump, false, false }); // next frame
+
+	StepQueue queue;
+	size_t used = queue.build(inputs, 0, 400, 4);
+	inputs.pop_front(used);
+	CHECK(used == 1);
+
+	// step 0 runs, then more inputs show up
+	CHECK(!queue.inputThisStep());
+	queue.skipStep();
+
+	size_t from = inputs.size();
+	inputs.emplace_back(StepInput{ 50, InputLeft, true, false }); // step 0 already ran
+	inputs.emplace_back(StepInput{ 220, InputRight, true, false }); // before the input already on step 2
+	CHECK(queue.splice(inputs, from) == 2);
+	inputs.erase(from, 2);
+	CHECK(inputs.size() == 1 && inputs[0].timestamp == 450);
+
+	std::vector<Walked> got = walk(queue, 3);
+	std::vector<uint8_t> order;
+	for (const Walked& w : got) {
+		if (w.fired) order.push_back(w.button);
+	}
+	CHECK((order == std::vector<uint8_t>{ InputLeft, InputRight, InputJump }));
+	auto firstFired = std::find_if(got.begin(), got.end(), [](const Walked& w) { return w.fired; });
+	CHECK(firstFired != got.end() && firstFired->index == 1); // the late input went on the next step to run
+
+	// inputs from after the end of the frame go on the next step to run, after everything already placed
+	inputs.clear();
+	inputs.emplace_back(StepInput{ 350, InputJump, true, false });
+	queue.build(inputs, 0, 400, 4);
+	inputs.clear();
+	queue.skipStep();
+	inputs.emplace_back(StepInput{ 420, InputJump, false, false });
+	CHECK(queue.splice(inputs, 0) == 1);
+	got = walk(queue, 3);
+	std::vector<bool> pushes;
+	for (const Walked& w : got) {
+		if (w.fired) pushes.push_back(w.isPush);
+	}
+	CHECK((pushes == std::vector<bool>{ true, false })); // never released before it's pressed
+	CHECK(got.back().index == 3);
+
+	// a press deferred by build() and its release showing up halfway through the frame go in together, in order
+	inputs.clear();
+	inputs.emplace_back(StepInput{ 420, InputJump, true, false });
+	CHECK(queue.build(inputs, 0, 400, 4) == 0);
+	queue.skipStep();
+	inputs.emplace_back(StepInput{ 430, InputJump, false, false });
+	CHECK(queue.splice(inputs, 0) == 2);
+	inputs.pop_front(2);
+	CHECK(inputs.empty());
+	got = walk(queue, 3);
+	pushes.clear();
+	for (const Walked& w : got) {
+		if (w.fired) pushes.push_back(w.isPush);
+	}
+	CHECK((pushes == std::vector<bool>{ true, false }));
+
+	// with nothing placed, the next step
+	inputs.clear();
+	queue.build(inputs, 0, 400, 4);
+	queue.skipStep();
+	inputs.emplace_back(StepInput{ 500, InputLeft, true, false });
+	CHECK(queue.splice(inputs, 0) == 1);
+	CHECK(queue.inputThisStep());
+}
+
+/*
+a frame the way the game drives the queue: build, run the steps, splice in inputs that show up halfway through
+the walk doesn't use walk() so it doesn't allocate a vector per frame
+*/
+void runFrame(RingQueue<StepInput>& inputs, StepQueue& queue, std::mt19937_64& rng, TimestampType frameStart, TimestampType length, int stepCount, int inputCount, int lateCount) {
+	for (int i = 0; i < inputCount; i++) inputs.emplace_back(StepInput{ frameStart + static_cast<TimestampType>(rng() % length), static_cast<uint8_t>(InputJump + i % 3), (i & 1) == 0, false });
+	std::sort(&inputs[0], &inputs[0] + inputs.size(), [](const StepInput& a, const StepInput& b) { return a.timestamp < b.timestamp; });
+	inputs.pop_front(queue.build(inputs, frameStart, frameStart + length, stepCount));
+
+	for (int i = 0; i < stepCount; i++) {
+		if (i == stepCount / 2) {
+			size_t from = inputs.size();
+			for (int j = 0; j < lateCount; j++) inputs.emplace_back(StepInput{ frameStart + static_cast<TimestampType>(rng() % length), InputJump, (j & 1) == 0, true });
+			inputs.erase(from, queue.splice(inputs, from));
+		}
+
+		if (!queue.inputThisStep()) {
+			queue.skipStep();
+			continue;
+		}
+		Step input, step;
+		do {
+			step = queue.pop(input);
+		} while (!step.endStep);
+	}
+	inputs.clear();
+}
+
+void testNoAllocations() {
+	constexpr int MAX_STEPS = 240, MAX_INPUTS = 64, MAX_LATE = 16;
+	std::mt19937_64 rng(3);
+	RingQueue<StepInput> inputs;
+	StepQueue queue;
+	queue.setMinSubstep(0.05);
+
+	/*
+	the busiest frames there'll be, everything grows to fit them here
+	most steps -> most end steps, one step -> every input is still placed when the late ones arrive
+	*/
+	TimestampType time = 1'000'000'000;
+	for (int frame = 0; frame < 10; frame++, time += 16'666'667) {
+		runFrame(inputs, queue, rng, time, 16'666'667, MAX_STEPS, MAX_INPUTS, MAX_LATE);
+		runFrame(inputs, queue, rng, time, 16'666'667, 1, MAX_INPUTS, MAX_LATE);
+	}
+
+	size_t before = allocations.load();
+	for (int frame = 0; frame < 20000; frame++) {
+		TimestampType length = 1'000'000 + rng() % 50'000'000;
+		runFrame(inputs, queue, rng, time, length, 1 + rng() % MAX_STEPS, rng() % (MAX_INPUTS + 1), rng() % (MAX_LATE + 1));
+		time += length;
+	}
+	CHECK(allocations.load() == before);
+}
+
+void testRingQueue() {
+	RingQueue<int, 8> queue;
+
+	// wrap around many times without growing
+	int next = 0, expected = 0;
+	for (int round = 0; round < 100; round++) {
+		for (int i = 0; i < 5; i++) queue.push_back(next++);
+		CHECK(queue.back() == next - 1);
+		for (int i = 0; i < 5; i++) {
+			CHECK(queue.front() == expected++);
+			queue.pop_front();
+		}
+	}
+	CHECK(queue.capacity() == 8);
+	CHECK(queue.empty());
+
+	// grow while the contents wrap around the end of the buffer
+	for (int i = 0; i < 6; i++) queue.push_back(i);
+	queue.pop_front(4);
+	for (int i = 6; i < 20; i++) queue.push_back(i);
+	CHECK(queue.capacity() == 16);
+	CHECK(queue.size() == 16);
+	bool ordered = true;
+	for (size_t i = 0; i < queue.size(); i++) ordered &= queue[i] == static_cast<int>(i) + 4;
+	CHECK(ordered);
+
+	// erase from the middle keeps the order of the rest
+	queue.erase(2, 3);
+	CHECK(queue.size() == 13);
+	CHECK(queue[0] == 4 && queue[1] == 5 && queue[2] == 9);
+
+	queue.pop_front(100);
+	CHECK(queue.empty());
+}
+
+void testPredictors() {
+	EmaPredictor ema;
+	PercentilePredictor percentile;
+	HysteresisPredictor hysteresis;
+	PacingPredictor* predictors[] = { &ema, &percentile, &hysteresis };
+
+	for (PacingPredictor* predictor : predictors) {
+		// on time at 60fps -> 4 steps
+		int steps = 0;
+		for (int i = 0; i < 100; i++) steps = computeStepCount(1.0 / 60.0, 1.0f, BypassMode::Predicted, 1.0 / 60.0, *predictor);
+		CHECK(steps == 4);
+
+		// a hitch gets simulated in full
+		PacingBranch branch;
+		steps = computeStepCount(0.1, 1.0f, BypassMode::Predicted, 1.0 / 60.0, *predictor, nullptr, &branch);
+		CHECK(branch == PacingBranch::CatchUp);
+		CHECK(steps == 24);
+
+		// never below 240 steps per second
+		for (int i = 0; i < 100; i++) steps = computeStepCount(1.0 / 144.0, 1.0f, BypassMode::Predicted, 1.0 / 144.0, *predictor);
+		CHECK(steps == 2);
+
+		predictor->reset();
+	}
+
+	// a frame time right on a step boundary flickering across it moves the ema's count, not the hysteresis one
+	PacingStats emaStats, hysteresisStats;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> jitter(-0.0003, 0.0003);
+	for (int i = 0; i < 2000; i++) {
+		double delta = 0.01 + jitter(rng); // 2.4 steps, a 100fps game under a 144hz cap
+		computeStepCount(delta, 1.0f, BypassMode::Predicted, 1.0 / 144.0, ema, &emaStats);
+		computeStepCount(delta, 1.0f, BypassMode::Predicted, 1.0 / 144.0, hysteresis, &hysteresisStats);
+	}
+	CHECK(hysteresisStats.changes() <= emaStats.changes());
+
+	// the percentile ignores a single slow frame once it's over
+	percentile.reset();
+	for (int i = 0; i < 40; i++) computeStepCount(1.0 / 60.0, 1.0f, BypassMode::Predicted, 1.0 / 60.0, percentile);
+	computeStepCount(0.05, 1.0f, BypassMode::Predicted, 1.0 / 60.0, percentile);
+	CHECK(computeStepCount(1.0 / 60.0, 1.0f, BypassMode::Predicted, 1.0 / 60.0, percentile) == 4);
+
+	// vanilla and 2.1 don't touch the predictor
+	CHECK(computeStepCount(1.0 / 60.0, 1.0f, BypassMode::Off, 1.0 / 60.0, ema) == 4);
+	CHECK(computeStepCount(1.0 / 240.0, 1.0f, BypassMode::Legacy, 1.0 / 240.0, ema) == 4);
+}
+
+void testStepBudget() {
+	constexpr double STEP = 1.0 / 240.0;
+	auto near = [](double a, double b) { return std::fabs(a - b) < 1e-9; };
+
+	StepBudget budget;
+	double delta = 100 * STEP;
+	CHECK(!budget.active());
+	CHECK(budget.schedule(100, delta) == 100); // unlimited
+	CHECK(near(delta, 100 * STEP));
+
+	budget.setBudget(0.001);
+	CHECK(budget.schedule(100, delta) == 100); // no cost measured yet
+
+	budget.recordCost(0.0001, 1); // 100us per step -> 10 fit
+	delta = 4 * STEP;
+	CHECK(budget.schedule(4, delta) == 4);
+	CHECK(near(delta, 4 * STEP));
+
+	// a hitch only simulates what fits, the steps keep their length
+	delta = 25 * STEP;
+	CHECK(budget.schedule(25, delta) == 10);
+	CHECK(near(delta, 10 * STEP));
+	CHECK(near(budget.backlog(), 15 * STEP));
+	CHECK(budget.budgetHits() == 1);
+
+	// the backlog is paid back while there's room, until all of the time has been simulated
+	double simulated = 10 * STEP;
+	const int expected[] = { 10, 10, 7 };
+	for (int steps : expected) {
+		delta = 4 * STEP;
+		CHECK(budget.schedule(4, delta) == steps);
+		CHECK(delta / steps <= STEP + 1e-12);
+		simulated += delta;
+	}
+	CHECK(near(budget.backlog(), 0.0));
+	CHECK(near(simulated, 37 * STEP));
+
+	// paid back in the frame's own step length when it's shorter than 1/240
+	delta = 25 * STEP;
+	budget.schedule(25, delta);
+	delta = 1.0 / 144.0;
+	int steps = budget.schedule(2, delta);
+	CHECK(steps == 10);
+	CHECK(delta / steps <= 1.0 / 288.0 + 1e-12);
+
+	// at most a second is carried over
+	budget.clearBacklog();
+	delta = 2.0;
+	CHECK(budget.schedule(480, delta) == 10);
+	CHECK(near(budget.backlog(), StepBudget::MAX_BACKLOG));
+	CHECK(near(budget.droppedTime(), 2.0 - 10 * STEP - StepBudget::MAX_BACKLOG));
+
+	budget.clearBacklog();
+	budget.resetCounters();
+	CHECK(budget.frames() == 0);
+	CHECK(budget.droppedTime() == 0.0);
+}
+
+LinuxInputEvent event(DeviceType type, int evType, int code, int value) {
+	LinuxInputEvent ev{};
+	ev.type = static_cast<uint16_t>(evType);
+	ev.code = static_cast<uint16_t>(code);
+	ev.value = value;
+	ev.deviceType = type;
+	return ev;
+}
+
+void testLinuxBinds() {
+	constexpr size_t KEY_SPACE = 0x20, KEY_A = 0x41, KEY_UP = 0x26;
+	constexpr size_t CONTROLLER_A = 0x3E9, CONTROLLER_LEFT = 0x3F3, CONTROLLER_RIGHT = 0x3F4, CONTROLLER_RT = 0x3EE;
+
+	std::array<std::unordered_set<size_t>, 6> binds;
+	binds[p1Jump] = { KEY_SPACE, CONTROLLER_A, CONTROLLER_RT };
+	binds[p1Left] = { KEY_A, CONTROLLER_LEFT };
+	binds[p1Right] = { CONTROLLER_RIGHT };
+	binds[p2Jump] = { KEY_UP, KEY_SPACE }; // p1 jump wins
+
+	LinuxBinds linuxBinds;
+	linuxBinds.compileActions(binds);
+	CHECK(linuxBinds.actionFor(KEY_SPACE) == p1Jump);
+	CHECK(linuxBinds.actionFor(KEY_UP) == p2Jump);
+	CHECK(linuxBinds.actionFor(0x7FFF) == UNBOUND);
+
+	// what the platform code fills in from the keyboard layout and controller mapping
+	linuxBinds.scanCodeActions[shm_code_index(0x39)] = linuxBinds.actionFor(KEY_SPACE);
+	linuxBinds.scanCodeActions[shm_code_index(0x1E)] = linuxBinds.actionFor(KEY_A);
+	linuxBinds.scanCodeActions[shm_code_index(0xE048)] = linuxBinds.actionFor(KEY_UP);
+	linuxBinds.buttonKeys[BTN_A] = CONTROLLER_A;
+	linuxBinds.axes[ABS_X] = LinuxBinds::Axis{ 16000, static_cast<int16_t>(CONTROLLER_LEFT), static_cast<int16_t>(CONTROLLER_RIGHT) };
+	linuxBinds.axes[ABS_RZ] = LinuxBinds::Axis{ 100, NO_KEY, static_cast<int16_t>(CONTROLLER_RT) };
+
+	StepInput input{};
+	CHECK(linuxBinds.translate(event(MOUSE, EV_KEY, BUTTON_LEFT, 1), input));
+	CHECK(input.button == InputJump && input.isPush && !input.isPlayer2);
+	CHECK(!linuxBinds.translate(event(MOUSE, EV_KEY, BUTTON_RIGHT, 1), input));
+	linuxBinds.rightClick = true;
+	CHECK(linuxBinds.translate(event(MOUSE, EV_KEY, BUTTON_RIGHT, 0), input));
+	CHECK(input.button == InputJump && !input.isPush && input.isPlayer2);
+
+	CHECK(linuxBinds.translate(event(KEYBOARD, EV_KEY, 0x1E, 1), input));
+	CHECK(input.button == InputLeft && input.isPush && !input.isPlayer2);
+	CHECK(linuxBinds.translate(event(KEYBOARD, EV_KEY, 0xE048, 0), input));
+	CHECK(input.button == InputJump && !input.isPush && input.isPlayer2);
+	CHECK(!linuxBinds.translate(event(KEYBOARD, EV_KEY, 0x10, 1), input)); // unbound
+
+	CHECK(linuxBinds.translate(event(TOUCHSCREEN, EV_KEY, BTN_TOUCH, 1), input));
+	CHECK(!linuxBinds.translate(event(TOUCHPAD, EV_KEY, BTN_TOUCH, 1), input));
+
+	// controller buttons only report changes
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_KEY, BTN_A, 1), input));
+	CHECK(!linuxBinds.translate(event(CONTROLLER, EV_KEY, BTN_A, 1), input));
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_KEY, BTN_A, 0), input));
+	CHECK(!input.isPush);
+
+	// sticks press the direction they're pushed past the deadzone, and release it when they come back
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_X, -20000), input));
+	CHECK(input.button == InputLeft && input.isPush);
+	CHECK(!linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_X, -30000), input));
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_X, 0), input));
+	CHECK(input.button == InputLeft && !input.isPush);
+	CHECK(!linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_X, 100), input));
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_X, 20000), input));
+	CHECK(input.button == InputRight && input.isPush);
+
+	// triggers have a single activation point
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_RZ, 200), input));
+	CHECK(input.button == InputJump && input.isPush);
+	CHECK(linuxBinds.translate(event(CONTROLLER, EV_ABS, ABS_RZ, 50), input));
+	CHECK(!input.isPush);
+
+	CHECK(!linuxBinds.translate(event(UNKNOWN, EV_KEY, BUTTON_LEFT, 1), input));
+}
+
+int main() {
+	testStepPlacement();
+	testCoalescing();
+	testSplice();
+	testNoAllocations();
+	testRingQueue();
+	testPredictors();
+	testStepBudget();
+	testLinuxBinds();
+
+	std::printf("%d checks, %d failed\n", checks, failures);
+	return failures ? 1 : 0;
+}
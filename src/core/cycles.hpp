@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+cheapest timestamp the CPU has, only meant for differences
+TSC on x86, the virtual counter on arm64, steady_clock ns anywhere else
+*/
+inline uint64_t readCycles() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t value;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+	return value;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// adds the cycles spent in a scope to a counter
+class ScopedCycles {
+public:
+	explicit ScopedCycles(uint64_t& total) : m_total(total), m_start(readCycles()) {}
+	~ScopedCycles() { m_total += readCycles() - m_start; }
+
+	ScopedCycles(const ScopedCycles&) = delete;
+	ScopedCycles& operator=(const ScopedCycles&) = delete;
+
+private:
+	uint64_t& m_total;
+	uint64_t m_start;
+};
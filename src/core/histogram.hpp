@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+/*
+fixed size log-linear histogram (HDR style)
+every power of 2 is split into SUB_BUCKETS linear buckets, so a recorded value is off by at most 1/SUB_BUCKETS
+recording is a couple of shifts and an increment, it never allocates
+*/
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 3;
+	static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static constexpr int MAGNITUDES = 40; // values up to ~2^43, well over an hour in ns
+	static constexpr int BUCKETS = (MAGNITUDES + 1) * SUB_BUCKETS;
+
+	void record(int64_t value) {
+		// clocks read on different cores can disagree by a little
+		uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+		m_counts[bucketFor(v)]++;
+		m_count++;
+		m_sum += v;
+		if (v > m_max) m_max = v;
+	}
+
+	void reset() {
+		m_counts.fill(0);
+		m_count = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	uint64_t count() const { return m_count; }
+	uint64_t max() const { return m_max; }
+	double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+	// upper bound of the bucket holding the p-th percentile (0-100)
+	uint64_t percentile(double p) const {
+		if (m_count == 0) return 0;
+		uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * m_count));
+		if (target == 0) target = 1;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKETS; i++) {
+			seen += m_counts[i];
+			if (seen >= target) return std::min(highestInBucket(i), m_max);
+		}
+		return m_max;
+	}
+
+private:
+	static int bucketFor(uint64_t value) {
+		if (value < SUB_BUCKETS) return static_cast<int>(value);
+
+		int shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+		if (shift >= MAGNITUDES) return BUCKETS - 1;
+		int sub = static_cast<int>(value >> shift) & (SUB_BUCKETS - 1);
+		return (shift + 1) * SUB_BUCKETS + sub;
+	}
+
+	static uint64_t highestInBucket(int index) {
+		int row = index / SUB_BUCKETS;
+		uint64_t sub = index % SUB_BUCKETS;
+		if (row == 0) return sub;
+
+		int shift = row - 1;
+		return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+	}
+
+	std::array<uint64_t, BUCKETS> m_counts{};
+	uint64_t m_count = 0;
+	uint64_t m_sum = 0;
+	uint64_t m_max = 0;
+};
@@ -0,0 +1,10 @@
+#include "latency.hpp"
+
+void InputLatency::record(const InputTrace& trace, TimestampType handled) {
+	if (trace.source >= SOURCE_COUNT) return;
+	Source& source = m_sources[trace.source];
+
+	source.toFrame.record(toNs(trace.frame - trace.timestamp));
+	source.toHandled.record(toNs(handled - trace.timestamp));
+	if (trace.scheduled > trace.timestamp) source.clamped.record(toNs(trace.scheduled - trace.timestamp));
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+
+#include "histogram.hpp"
+#include "steps.hpp"
+
+/*
+how long inputs take from happening to reaching handleButton, per InputSource
+all histograms are in ns
+*/
+class InputLatency {
+public:
+	struct Source {
+		LatencyHistogram toFrame; // timestamp -> end of the frame it was scheduled into
+		LatencyHistogram toHandled; // timestamp -> handleButton running
+		LatencyHistogram clamped; // how far the input was moved to fit in its frame, only clamped inputs
+		uint64_t deferred = 0; // times an input was newer than the frame and waited for the next one
+	};
+
+	void setFrequency(int64_t ticksPerSecond) { m_nsPerTick = 1e9 / static_cast<double>(ticksPerSecond); }
+
+	// an input reached handleButton at `handled`
+	void record(const InputTrace& trace, TimestampType handled);
+	// an input was left for the next frame
+	void deferred(uint8_t source) { if (source < SOURCE_COUNT) m_sources[source].deferred++; }
+
+	const Source& source(InputSource source) const { return m_sources[source]; }
+	void reset() { m_sources = {}; }
+
+private:
+	int64_t toNs(int64_t ticks) const { return static_cast<int64_t>(ticks * m_nsPerTick); }
+
+	double m_nsPerTick = 1.0;
+	std::array<Source, SOURCE_COUNT> m_sources;
+};
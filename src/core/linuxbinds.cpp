@@ -0,0 +1,85 @@
+#include "linuxbinds.hpp"
+
+LinuxBinds::LinuxBinds() {
+	keyActions.fill(UNBOUND);
+	scanCodeActions.fill(UNBOUND);
+	buttonKeys.fill(NO_KEY);
+	axes.fill(Axis{ 0, NO_KEY, NO_KEY });
+}
+
+void LinuxBinds::compileActions(const std::array<std::unordered_set<size_t>, 6>& binds) {
+	keyActions.fill(UNBOUND);
+	for (int action = p2Right; action >= p1Jump; action--) {
+		for (size_t keyCode : binds[action]) {
+			if (keyCode < KEY_CODE_COUNT) keyActions[keyCode] = action;
+		}
+	}
+}
+
+bool LinuxBinds::translate(const LinuxInputEvent& ev, StepInput& input) {
+	int8_t action = UNBOUND;
+	int value = ev.value;
+
+	switch (ev.deviceType) {
+	case MOUSE:
+	case TOUCHPAD:
+		if (ev.code == BUTTON_LEFT) action = p1Jump;
+		else if (ev.code == BUTTON_RIGHT && rightClick) action = p2Jump;
+		break;
+	case KEYBOARD:
+		if (ev.code <= KEY_MAX || (ev.code & 0xFF00) == 0xE000) action = scanCodeActions[shm_code_index(ev.code)];
+		break;
+	case TOUCHSCREEN:
+		if (ev.code == BTN_TOUCH) action = p1Jump;
+		break;
+	case CONTROLLER: {
+		int keyCode = NO_KEY;
+		if (ev.type == EV_KEY) {
+			if (ev.code <= KEY_MAX) keyCode = buttonKeys[ev.code];
+		}
+		else if (ev.type == EV_ABS && ev.code < axes.size()) {
+			const Axis& axis = axes[ev.code];
+			auto isHeld = [&](int16_t key) { return key != NO_KEY && held.test(key); };
+
+			if (axis.negative == NO_KEY) { // trigger
+				keyCode = axis.positive;
+				value = ev.value > axis.threshold ? Press : Release;
+			}
+			else if (ev.value < -axis.threshold) {
+				if (isHeld(axis.negative)) return false;
+				keyCode = axis.negative;
+				value = Press;
+			}
+			else if (ev.value > axis.threshold) {
+				if (isHeld(axis.positive)) return false;
+				keyCode = axis.positive;
+				value = Press;
+			}
+			else {
+				value = Release;
+				if (isHeld(axis.negative)) keyCode = axis.negative;
+				else if (isHeld(axis.positive)) keyCode = axis.positive;
+				else return false;
+			}
+		}
+
+		action = keyCode == NO_KEY ? UNBOUND : actionFor(keyCode);
+		if (action == UNBOUND) return false;
+
+		// only forward changes, sticks report every movement
+		if (held.test(keyCode) == (value == Press)) return false;
+		held.set(keyCode, value == Press);
+		break;
+	}
+	default:
+		return false;
+	}
+
+	if (action == UNBOUND) return false;
+
+	static constexpr uint8_t buttons[] = { InputJump, InputLeft, InputRight };
+	input.button = buttons[action % 3];
+	input.isPush = value != Release;
+	input.isPlayer2 = action >= p2Jump;
+	return true;
+}
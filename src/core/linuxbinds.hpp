@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <unordered_set>
+
+#include "types.hpp"
+#include "../linuxshm.hpp"
+#include "../linuxeventcodes.hpp"
+
+// GD's key codes for keyboard keys and controller buttons are all below this
+constexpr size_t KEY_CODE_COUNT = 0x800;
+constexpr int8_t UNBOUND = -1;
+constexpr int16_t NO_KEY = -1;
+
+/*
+turns linux-input events into inputs, using tables compiled from the keybinds
+the platform code fills in the parts that depend on GD's key codes and the keyboard layout
+*/
+struct LinuxBinds {
+	struct Axis {
+		int threshold; // deadzone for sticks and hats, activation point for triggers
+		int16_t negative; // NO_KEY -> trigger, only positive is used
+		int16_t positive;
+	};
+
+	std::array<int8_t, KEY_CODE_COUNT> keyActions; // key code -> GameAction
+	std::array<int8_t, SHM_CODE_COUNT> scanCodeActions; // shm_code_index(scancode) -> GameAction
+	std::array<int16_t, KEY_MAX + 1> buttonKeys; // evdev controller button -> key code
+	std::array<Axis, ABS_HAT0Y + 1> axes; // evdev controller axis -> key codes
+	std::bitset<KEY_CODE_COUNT> held; // controller directions/buttons currently pressed
+	bool rightClick = false; // right click -> P2 jump
+
+	LinuxBinds();
+
+	// the first action a key is bound to wins
+	void compileActions(const std::array<std::unordered_set<size_t>, 6>& binds);
+
+	int8_t actionFor(size_t keyCode) const { return keyCode < KEY_CODE_COUNT ? keyActions[keyCode] : UNBOUND; }
+
+	// false if the event doesn't affect gameplay, input.timestamp is left to the caller
+	bool translate(const LinuxInputEvent& ev, StepInput& input);
+};
@@ -0,0 +1,98 @@
+#include "pacing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr double STEP = 1.0 / 240.0;
+
+PacingPredictor::Prediction EmaPredictor::predict(double delta, double animationInterval) {
+	m_average = (0.05 * delta) + (0.95 * m_average); // exponential moving average to detect lag/external fps caps
+	if (m_average > animationInterval * 10) m_average = animationInterval * 10; // dont let m_average get too high
+
+	bool laggingOneFrame = animationInterval < delta - STEP; // more than 1 step of lag on a single frame
+	bool laggingManyFrames = m_average - animationInterval > 0.0005; // average lag is >0.5ms
+
+	if (!laggingOneFrame && !laggingManyFrames) { // no stepcount variance when not lagging
+		return { std::ceil((animationInterval * 240.0) - 0.0001), PacingBranch::Steady };
+	}
+	else if (!laggingOneFrame) { // consistently low fps
+		return { std::ceil(m_average * 240.0), PacingBranch::Average };
+	}
+	else { // need to catch up badly
+		return { std::ceil(delta * 240.0), PacingBranch::CatchUp };
+	}
+}
+
+PacingPredictor::Prediction PercentilePredictor::predict(double delta, double animationInterval) {
+	m_deltas[m_next] = delta;
+	m_next = (m_next + 1) % WINDOW;
+	if (m_count < WINDOW) m_count++;
+
+	std::array<double, WINDOW> sorted = m_deltas;
+	int rank = std::clamp(static_cast<int>(std::ceil(m_percentile / 100.0 * m_count)) - 1, 0, m_count - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + m_count);
+	double typical = std::max(animationInterval, sorted[rank]);
+
+	if (delta - typical > STEP) return { std::ceil(delta * 240.0), PacingBranch::CatchUp };
+	return { std::ceil((typical * 240.0) - 0.0001), typical > animationInterval ? PacingBranch::Average : PacingBranch::Steady };
+}
+
+PacingPredictor::Prediction HysteresisPredictor::predict(double delta, double animationInterval) {
+	m_average = m_average == 0.0 ? delta : (0.05 * delta) + (0.95 * m_average);
+	if (m_average > animationInterval * 10) m_average = animationInterval * 10;
+
+	int target = static_cast<int>(std::ceil((std::max(animationInterval, m_average) * 240.0) - 0.0001));
+	if (m_steps == 0 || std::abs(target - m_steps) >= JUMP_STEPS) {
+		m_steps = target;
+		m_pending = 0;
+	}
+	else if (target != m_steps) {
+		if (++m_pending >= HOLD_FRAMES) {
+			m_steps = target;
+			m_pending = 0;
+		}
+	}
+	else m_pending = 0;
+
+	if (delta - m_steps * STEP > STEP) return { std::ceil(delta * 240.0), PacingBranch::CatchUp };
+	return { static_cast<double>(m_steps), m_average > animationInterval ? PacingBranch::Average : PacingBranch::Steady };
+}
+
+void PacingStats::record(int steps, bool catchUp) {
+	if (m_frames && steps != m_last) m_changes++;
+	if (catchUp) m_catchUps++;
+	m_frames++;
+	m_last = steps;
+	m_sum += steps;
+	m_sumSquares += static_cast<double>(steps) * steps;
+}
+
+double PacingStats::mean() const {
+	return m_frames ? m_sum / m_frames : 0.0;
+}
+
+double PacingStats::variance() const {
+	if (m_frames == 0) return 0.0;
+	double mean = this->mean();
+	return std::max(0.0, m_sumSquares / m_frames - mean * mean);
+}
+
+/*
+need to rewrite the vanilla formula bc otherwise you'd have to use inline assembly to get the step count
+*/
+int computeStepCount(double delta, float timewarp, BypassMode mode, double animationInterval, PacingPredictor& predictor, PacingStats* stats, PacingBranch* branch) {
+	if (mode == BypassMode::Off) { // vanilla 2.2
+		if (branch) *branch = PacingBranch::Vanilla;
+		return std::round(std::max(1.0, ((delta * 60.0) / std::min(1.0f, timewarp)) * 4.0)); // not sure if this is different from `(delta * 240) / timewarp` bc of float precision
+	}
+	else if (mode == BypassMode::Legacy) { // 2.1 physics bypass (same as vanilla 2.1)
+		if (branch) *branch = PacingBranch::Legacy;
+		return std::round(std::max(4.0, delta * 240.0) / std::min(1.0f, timewarp));
+	}
+
+	PacingPredictor::Prediction prediction = predictor.predict(delta, animationInterval);
+	int steps = std::round(prediction.steps / std::min(1.0f, timewarp));
+	if (stats) stats->record(steps, prediction.branch == PacingBranch::CatchUp);
+	if (branch) *branch = prediction.branch;
+	return steps;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// which formula a step count came from
+enum class PacingBranch : uint8_t {
+	Vanilla,
+	Legacy,
+	Steady, // frames are on time, simulate the target frame length
+	Average, // frames are consistently slow, simulate the typical frame length
+	CatchUp // the frame took way longer than predicted, so it's simulated in full
+};
+
+/*
+physics bypass picks the step count from how long frames take, these decide what "how long" means
+*/
+class PacingPredictor {
+public:
+	struct Prediction {
+		double steps; // at timewarp 1
+		PacingBranch branch;
+	};
+
+	virtual ~PacingPredictor() = default;
+	virtual Prediction predict(double delta, double animationInterval) = 0;
+	virtual void reset() = 0;
+	virtual const char* name() const = 0;
+};
+
+// exponential moving average of the frame time, with fixed lag thresholds (the original 2.2 bypass)
+class EmaPredictor : public PacingPredictor {
+public:
+	Prediction predict(double delta, double animationInterval) override;
+	void reset() override { m_average = 0.0; }
+	const char* name() const override { return "ema"; }
+
+private:
+	double m_average = 0.0;
+};
+
+// a percentile of the last WINDOW frame times, so single slow frames don't move it
+class PercentilePredictor : public PacingPredictor {
+public:
+	static constexpr int WINDOW = 32;
+
+	explicit PercentilePredictor(double percentile = 50.0) : m_percentile(percentile) {}
+
+	Prediction predict(double delta, double animationInterval) override;
+	void reset() override { m_count = 0; m_next = 0; }
+	const char* name() const override { return "percentile"; }
+
+private:
+	double m_percentile;
+	std::array<double, WINDOW> m_deltas{};
+	int m_count = 0;
+	int m_next = 0;
+};
+
+// keeps the current step count until the average frame time has wanted a different one for a while
+class HysteresisPredictor : public PacingPredictor {
+public:
+	static constexpr int HOLD_FRAMES = 8; // frames a 1 step change has to persist
+	static constexpr int JUMP_STEPS = 2; // changes at least this big happen immediately
+
+	Prediction predict(double delta, double animationInterval) override;
+	void reset() override { m_average = 0.0; m_steps = 0; m_pending = 0; }
+	const char* name() const override { return "hysteresis"; }
+
+private:
+	double m_average = 0.0;
+	int m_steps = 0;
+	int m_pending = 0;
+};
+
+// step count variance and catch-up frames, for comparing predictors
+class PacingStats {
+public:
+	void record(int steps, bool catchUp);
+	void reset() { *this = PacingStats{}; }
+
+	uint64_t frames() const { return m_frames; }
+	uint64_t changes() const { return m_changes; } // frames whose step count differs from the previous frame's
+	uint64_t catchUps() const { return m_catchUps; }
+	double mean() const;
+	double variance() const;
+
+private:
+	uint64_t m_frames = 0;
+	uint64_t m_changes = 0;
+	uint64_t m_catchUps = 0;
+	int m_last = 0;
+	double m_sum = 0.0;
+	double m_sumSquares = 0.0;
+};
+
+enum class BypassMode {
+	Off, // vanilla 2.2
+	Legacy, // 2.1 physics bypass
+	Predicted // 2.2 + physics bypass, doesn't go below 240 steps/sec
+};
+
+/*
+number of physics steps for a frame of length delta
+the predictor is only used (and stats only recorded) for BypassMode::Predicted
+*/
+int computeStepCount(double delta, float timewarp, BypassMode mode, double animationInterval, PacingPredictor& predictor, PacingStats* stats = nullptr, PacingBranch* branch = nullptr);
@@ -0,0 +1,36 @@
+#include "recorder.hpp"
+#include "cycles.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+FrameRecord& FlightRecorder::next(TimestampType time) {
+	FrameRecord& record = m_records[m_next % CAPACITY];
+	m_next++;
+
+	record = FrameRecord{};
+	record.time = time;
+	record.cycles = readCycles();
+	return record;
+}
+
+bool FlightRecorder::dump(const std::filesystem::path& path, DumpReason reason, int64_t timestampFrequency) const {
+	uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(m_next, CAPACITY));
+
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	RecorderHeader header{ RECORDER_MAGIC, RECORDER_VERSION, sizeof(FrameRecord), count, static_cast<uint32_t>(reason), 0, timestampFrequency };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// oldest first, the ring may have wrapped
+	uint64_t first = m_next - count;
+	for (uint64_t i = first; i < m_next; i++) {
+		file.write(reinterpret_cast<const char*>(&m_records[i % CAPACITY]), sizeof(FrameRecord));
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "types.hpp"
+
+/*
+fixed size ring of per-frame records, always recording, dumped to a file when something went wrong
+file layout: a RecorderHeader followed by `count` FrameRecords, oldest first
+*/
+
+constexpr uint32_t RECORDER_MAGIC = 0x52464243; // "CBFR"
+constexpr uint32_t RECORDER_VERSION = 1;
+
+enum class DumpReason : uint32_t {
+	Manual, // paused
+	Death,
+	Exit
+};
+
+struct RecorderHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t count;
+	uint32_t reason; // DumpReason
+	uint32_t reserved;
+	int64_t timestamp_frequency; // ticks per second of FrameRecord::time
+};
+
+// cycle counts are from readCycles(), compare `cycles` against `time` across records to get their frequency
+struct FrameRecord {
+	TimestampType time; // start of the frame
+	uint64_t cycles; // readCycles() at the start of the frame
+	float deltaTime; // s
+	int32_t stepCount;
+	uint32_t inputs; // inputs placed on this frame's steps
+	uint32_t substeps; // entries in the step schedule
+	uint8_t branch; // PacingBranch
+	uint8_t savedSubsteps; // substeps StepQueue coalesced, saturates at 255
+	uint16_t collisionChecks; // extra checkCollisions calls from split steps
+	int32_t backlog; // StepBudget backlog after this frame, us
+	uint64_t linuxInputCycles; // linuxCheckInputs
+	uint64_t splitCycles; // PlayerObject::update split loop, including the collision checks
+	uint64_t collisionCycles; // the extra checkCollisions calls
+};
+
+static_assert(sizeof(RecorderHeader) == 32, "RecorderHeader must stay 32 bytes");
+static_assert(sizeof(FrameRecord) == 64, "FrameRecord must stay 64 bytes");
+
+class FlightRecorder {
+public:
+	static constexpr uint32_t CAPACITY = 4096; // ~1 minute at 60fps, 256KB
+
+	FlightRecorder() : m_records(std::make_unique<FrameRecord[]>(CAPACITY)) {}
+
+	// finish the current frame's record and start a new one
+	FrameRecord& next(TimestampType time);
+	FrameRecord& current() { return m_records[(m_next - 1) % CAPACITY]; }
+	bool recording() const { return m_next != 0; }
+
+	// write every record in the ring, returns false if the file couldn't be written
+	bool dump(const std::filesystem::path& path, DumpReason reason, int64_t timestampFrequency) const;
+	void clear() { m_next = 0; }
+
+private:
+	std::unique_ptr<FrameRecord[]> m_records;
+	uint64_t m_next = 0; // total records started
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/*
+FIFO backed by a power of 2 ring buffer
+clear() and pop_front() never free anything, and the buffer only grows when it's full,
+so once it has seen the busiest frame it stops allocating entirely
+*/
+template <typename T, size_t InitialCapacity = 64>
+class RingQueue {
+	static_assert(InitialCapacity && (InitialCapacity & (InitialCapacity - 1)) == 0, "capacity must be a power of 2");
+
+public:
+	RingQueue() : m_data(std::make_unique<T[]>(InitialCapacity)), m_capacity(InitialCapacity) {}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args) {
+		if (m_size == m_capacity) grow();
+		T& slot = m_data[(m_head + m_size) & (m_capacity - 1)];
+		slot = T{ std::forward<Args>(args)... };
+		m_size++;
+		return slot;
+	}
+
+	void push_back(const T& value) { emplace_back(value); }
+
+	T& front() { return m_data[m_head]; }
+	const T& front() const { return m_data[m_head]; }
+	T& back() { return (*this)[m_size - 1]; }
+	const T& back() const { return (*this)[m_size - 1]; }
+
+	T& operator[](size_t i) { return m_data[(m_head + i) & (m_capacity - 1)]; }
+	const T& operator[](size_t i) const { return m_data[(m_head + i) & (m_capacity - 1)]; }
+
+	void pop_front() { pop_front(1); }
+
+	// drop the first n elements
+	void pop_front(size_t n) {
+		if (n > m_size) n = m_size;
+		m_head = (m_head + n) & (m_capacity - 1);
+		m_size -= n;
+	}
+
+	// remove n elements starting at pos, the ones before it move up to fill the gap
+	void erase(size_t pos, size_t n) {
+		if (pos >= m_size) return;
+		if (n > m_size - pos) n = m_size - pos;
+		for (size_t i = pos; i-- > 0;) (*this)[i + n] = std::move((*this)[i]);
+		pop_front(n);
+	}
+
+	void clear() {
+		m_head = 0;
+		m_size = 0;
+	}
+
+	bool empty() const { return m_size == 0; }
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_capacity; }
+
+private:
+	void grow() {
+		size_t capacity = m_capacity * 2;
+		auto data = std::make_unique<T[]>(capacity);
+		for (size_t i = 0; i < m_size; i++) data[i] = std::move((*this)[i]);
+
+		m_data = std::move(data);
+		m_capacity = capacity;
+		m_head = 0;
+	}
+
+	std::unique_ptr<T[]> m_data;
+	size_t m_capacity;
+	size_t m_head = 0;
+	size_t m_size = 0;
+};
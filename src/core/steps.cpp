@@ -0,0 +1,187 @@
+#include "steps.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+size_t StepQueue::build(const RingQueue<StepInput>& inputs, TimestampType frameStart, TimestampType frameEnd, int stepCount) {
+	clear();
+
+	int64_t deltaTime = frameEnd - frameStart;
+	if (deltaTime <= 0 || stepCount <= 0) return 0;
+
+	// scale everything down in the (absurd) case where elapsed * stepCount could overflow
+	int shift = 0;
+	while ((deltaTime >> shift) > INT64_MAX / stepCount) shift++;
+
+	m_frameStart = frameStart;
+	m_frameEnd = frameEnd;
+	m_deltaTime = deltaTime >> shift;
+	m_stepCount = stepCount;
+	m_shift = shift;
+
+	size_t inputIdx = 0;
+	for (; inputIdx < inputs.size(); inputIdx++) {
+		const StepInput& input = inputs[inputIdx];
+		int64_t elapsed = (input.timestamp - frameStart) >> shift;
+		if (elapsed >= m_deltaTime) break; // happened after the end of the frame, keep it for the next one
+
+		// inputs from before the frame started go at the very start of it
+		int64_t scaled = std::max<int64_t>(elapsed, 0) * stepCount;
+		int64_t inputStep = scaled / m_deltaTime;
+		int64_t inputTime = scaled % m_deltaTime; // proportion of step elapsed at the time the input was made
+
+		if (!m_placed.empty() && inputStep <= m_placed.back().step) { // out of order, don't go backwards
+			inputStep = m_placed.back().step;
+			inputTime = std::max(inputTime, m_placed.back().time);
+		}
+
+		m_placed.emplace_back(Placement{ inputStep, inputTime, input, false });
+	}
+	schedule();
+
+	return inputIdx;
+}
+
+size_t StepQueue::splice(const RingQueue<StepInput>& inputs, size_t from) {
+	if (m_deltaTime <= 0 || m_currentStep >= m_stepCount || !m_nextInput.endStep) return 0;
+
+	// the steps before the current one are done, only the ones after it can change
+	while (!m_placed.empty() && m_placed.front().step < m_currentStep) {
+		if (m_placed.front().saved) m_savedRun++;
+		m_placed.pop_front();
+	}
+
+	for (size_t inputIdx = from; inputIdx < inputs.size(); inputIdx++) {
+		const StepInput& input = inputs[inputIdx];
+		int64_t elapsed = (input.timestamp - m_frameStart) >> m_shift;
+
+		int64_t inputStep, inputTime;
+		if (elapsed >= m_deltaTime) {
+			// happened after the end of the frame while its steps were still running, so after everything placed so far
+			inputStep = m_currentStep;
+			inputTime = 0;
+			if (!m_placed.empty() && m_placed.back().step >= inputStep) {
+				inputStep = m_placed.back().step;
+				inputTime = m_placed.back().time;
+			}
+		}
+		else {
+			int64_t scaled = std::max<int64_t>(elapsed, 0) * m_stepCount;
+			inputStep = scaled / m_deltaTime;
+			inputTime = scaled % m_deltaTime;
+			if (inputStep < m_currentStep) { // its step already ran, this is as early as it can still go
+				inputStep = m_currentStep;
+				inputTime = 0;
+			}
+		}
+
+		// inputs can arrive out of order, slot it in after everything placed at or before the same point
+		m_placed.emplace_back(Placement{ inputStep, inputTime, input, false });
+		for (size_t i = m_placed.size() - 1; i > 0; i--) {
+			const Placement& previous = m_placed[i - 1];
+			if (previous.step < inputStep || (previous.step == inputStep && previous.time <= inputTime)) break;
+			std::swap(m_placed[i - 1], m_placed[i]);
+		}
+	}
+
+	if (inputs.size() > from) schedule();
+	return inputs.size() - from;
+}
+
+void StepQueue::schedule() {
+	m_steps.clear();
+	m_traces.clear();
+	m_saved = m_savedRun;
+
+	// within a step, positions are measured in 1/deltaTime of a step
+	const int64_t deltaTime = m_deltaTime;
+	const double toFactor = 1.0 / static_cast<double>(deltaTime);
+	const int64_t minGap = static_cast<int64_t>(m_minSubstep * static_cast<double>(deltaTime));
+
+	int64_t step = -1; // step currently being filled, -1 -> none yet
+	int64_t elapsedTime = 0; // position of the last input within that step
+	uint16_t substep = 0;
+
+	auto closeStep = [&]() {
+		if (step >= 0) m_steps.emplace_back(Step{ static_cast<uint32_t>(step), static_cast<float>(std::max(SMALLEST_FLOAT, (deltaTime - elapsedTime) * toFactor)), InputJump, false, false, true });
+	};
+
+	for (size_t i = 0; i < m_placed.size(); i++) {
+		Placement& placement = m_placed[i];
+		const StepInput& input = placement.input;
+		int64_t inputTime = placement.time;
+		placement.saved = false;
+
+		bool coalesced = false;
+		if (placement.step == step) {
+			if (inputTime - elapsedTime < minGap) {
+				// too close to the previous input to be worth a substep of its own
+				inputTime = elapsedTime;
+				coalesced = true;
+				placement.saved = true;
+
+				const Step& previous = m_steps.back();
+				if (input.isPush && previous.isPush && previous.button == input.button && previous.isPlayer2 == input.isPlayer2) {
+					m_saved++; // the same press twice in one place, e.g. two keys bound to jump
+					continue;
+				}
+			}
+			substep++;
+		}
+		else {
+			closeStep();
+			step = placement.step;
+			elapsedTime = 0;
+			substep = 0;
+		}
+		if (coalesced) m_saved++;
+
+		m_steps.emplace_back(Step{
+			static_cast<uint32_t>(step),
+			coalesced ? 0.0f : static_cast<float>(std::clamp((inputTime - elapsedTime) * toFactor, SMALLEST_FLOAT, 1.0)),
+			input.button,
+			input.isPush,
+			input.isPlayer2,
+			false
+		});
+		elapsedTime = inputTime;
+
+		TimestampType scheduled = m_frameStart + (((step * deltaTime + inputTime) / m_stepCount) << m_shift);
+		m_traces.emplace_back(InputTrace{ input.timestamp, m_frameEnd, scheduled, static_cast<uint32_t>(step), substep, input.source });
+	}
+	closeStep();
+}
+
+Step StepQueue::pop(Step& input) {
+	input = EMPTY_STEP;
+	if (m_steps.empty()) return EMPTY_STEP;
+	if (m_steps.front().index != m_currentStep) { // m_nextInput is always empty here, the previous substep ended a step
+		m_currentStep++;
+		return EMPTY_STEP;
+	}
+
+	Step front = m_steps.front();
+	if (front.endStep) m_currentStep++;
+
+	input = m_nextInput;
+	m_nextInput = front;
+	m_steps.pop_front();
+
+	if (!input.endStep && !m_traces.empty()) {
+		m_fired = m_traces.front();
+		m_traces.pop_front();
+	}
+
+	return front;
+}
+
+void StepQueue::clear() {
+	m_placed.clear();
+	m_steps.clear();
+	m_traces.clear();
+	m_currentStep = 0;
+	m_nextInput = EMPTY_STEP;
+	m_saved = 0;
+	m_savedRun = 0;
+	m_deltaTime = 0;
+}
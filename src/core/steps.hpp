@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+#include "types.hpp"
+#include "ringqueue.hpp"
+
+constexpr double SMALLEST_FLOAT = std::numeric_limits<float>::min();
+
+/*
+one substep of a physics step, the input (if any) is applied at the start of the next substep
+only physics steps with inputs get entries, every other step is an implicit full-length step
+*/
+struct Step {
+	uint32_t index; // physics step of the frame this substep belongs to
+	float deltaFactor; // proportion of the physics step this substep covers, 0 -> coalesced, no physics runs before the next input
+	uint8_t button; // InputButton
+	bool isPush;
+	bool isPlayer2;
+	bool endStep; // last substep of the physics step, carries no input
+};
+
+static_assert(sizeof(Step) == 12);
+
+// where and when an input was scheduled, kept alongside its Step until handleButton runs
+struct InputTrace {
+	TimestampType timestamp; // when the input happened
+	TimestampType frame; // end of the frame it was scheduled into
+	TimestampType scheduled; // the point in the frame its substep starts at, differs from timestamp when it had to be clamped
+	uint32_t step;
+	uint16_t substep; // inputs before it on the same step
+	uint8_t source; // InputSource
+};
+
+constexpr Step EMPTY_STEP = Step {
+	.index = 0,
+	.deltaFactor = 1.0f,
+	.button = InputJump,
+	.isPush = false,
+	.isPlayer2 = false,
+	.endStep = true,
+};
+
+/*
+the physics steps of one frame, and the inputs that land in between them
+reused across frames and only ever grows, so normal gameplay doesn't allocate
+*/
+class StepQueue {
+public:
+	/*
+	split the frame [frameStart, frameEnd) into stepCount steps and place each input on the step it happened during
+	step assignment is exact integer math on the ticks, they're only turned into deltaFactors once per substep
+	inputs must be sorted by timestamp, returns how many of them happened before the end of the frame
+	*/
+	size_t build(const RingQueue<StepInput>& inputs, TimestampType frameStart, TimestampType frameEnd, int stepCount);
+
+	/*
+	add inputs that arrived after build() to the steps of the same frame that haven't run yet
+	only works between two physics steps, inputs from steps that already ran go at the start of the next one,
+	and inputs from after the end of the frame go after everything already placed, no earlier than the next step
+	uses inputs[from] onwards, returns how many of them were placed (all of them, unless it's not between two steps)
+	from 0 also places whatever build() left for the next frame, so a late release can't go in ahead of a press that was held back
+	*/
+	size_t splice(const RingQueue<StepInput>& inputs, size_t from);
+
+	/*
+	inputs less than `fraction` of a step after the previous input on the same step share its substep instead of getting their own
+	a repeated press of the same button at the same point is dropped, anything else still reaches handleButton in order
+	0 turns it off
+	*/
+	void setMinSubstep(double fraction) { m_minSubstep = std::clamp(fraction, 0.0, 1.0); }
+
+	// substeps the last build() coalesced or dropped
+	uint32_t saved() const { return m_saved; }
+
+	/*
+	return the next substep, which is a full-length step if the current step has no inputs
+	`input` is set to the input of the previous substep, or EMPTY_STEP if there wasn't one
+	*/
+	Step pop(Step& input);
+
+	// trace of the input pop() last returned
+	const InputTrace& firedTrace() const { return m_fired; }
+
+	// whether the physics step about to run gets split
+	bool inputThisStep() const { return !m_steps.empty() && m_steps.front().index == m_currentStep; }
+
+	// the current step runs without going through pop()
+	void skipStep() { m_currentStep++; }
+
+	void clear();
+	bool empty() const { return m_steps.empty(); }
+	size_t size() const { return m_steps.size(); }
+
+private:
+	// an input's position in the frame, m_steps is generated from these
+	struct Placement {
+		int64_t step;
+		int64_t time; // in 1/m_deltaTime of a step
+		StepInput input;
+		bool saved; // coalesced or dropped by the last schedule()
+	};
+
+	// turn m_placed into m_steps and m_traces
+	void schedule();
+
+	RingQueue<Placement> m_placed; // this frame's inputs on steps that haven't finished, in order
+	RingQueue<Step> m_steps;
+	RingQueue<InputTrace> m_traces; // one per input Step, in the same order
+	InputTrace m_fired{};
+	uint32_t m_currentStep = 0; // index of the physics step about to run, compared against m_steps.front().index
+	Step m_nextInput = EMPTY_STEP; // endStep -> no input pending
+	double m_minSubstep = 0.0;
+	uint32_t m_saved = 0;
+	uint32_t m_savedRun = 0; // saved on steps that were dropped from m_placed
+
+	// the frame build() was given, deltaTime is after scaling down by shift
+	TimestampType m_frameStart = 0;
+	TimestampType m_frameEnd = 0;
+	int64_t m_deltaTime = 0;
+	int64_t m_stepCount = 0;
+	int m_shift = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+using TimestampType = int64_t; // ticks of the platform clock, see timestamp.hpp
+
+enum GameAction : int {
+	p1Jump = 0,
+	p1Left = 1,
+	p1Right = 2,
+	p2Jump = 3,
+	p2Left = 4,
+	p2Right = 5
+};
+
+enum State : bool {
+	Release = 0,
+	Press = 1
+};
+
+// same values as GD's PlayerButton
+enum InputButton : uint8_t {
+	InputJump = 1,
+	InputLeft = 2,
+	InputRight = 3
+};
+
+// where an input came from
+enum InputSource : uint8_t {
+	SOURCE_ROBTOP, // GD's own m_queuedButtons
+	SOURCE_LINUX, // linux-input's ring
+	SOURCE_COUNT
+};
+
+// the parts of a PlayerButtonCommand the step schedule needs
+struct StepInput {
+	TimestampType timestamp;
+	uint8_t button; // InputButton
+	bool isPush;
+	bool isPlayer2;
+	uint8_t source = SOURCE_ROBTOP; // InputSource
+};
@@ -0,0 +1 @@
+g++ -O2 -o linux-input-bench linux-input-bench.cpp -pthread
@@ -1 +1 @@
-g++ -O2 -o ../../resources/linux-input.so linux-input.cpp -levdev
+g++ -O2 -o ../../resources/linux-input.so linux-input.cpp -levdev -pthread
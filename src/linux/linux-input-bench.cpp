@@ -0,0 +1,531 @@
+// Throughput/latency benchmark for linux-input. It plays the part of GD: it sets up the shared memory ring,
+// launches the daemon, injects click storms through virtual devices and measures what comes out of the ring.
+//
+// Devices are created through /dev/uinput when it's writable, otherwise (or with --fake) the daemon is handed
+// pipes with --fake-device, which skips evdev but exercises the same read/translate/publish path.
+//
+// --idle <s> injects nothing and checks the daemon sleeps through it, only waking up for the watchdog.
+// --verify stamps a per-device sequence number into every event and checks they all come out of the ring in order.
+
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "../linuxshm.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+constexpr const char* DEFAULT_DAEMON = "../../resources/linux-input.so";
+constexpr int64_t WARMUP_TIMEOUT_NS = 5'000'000'000;
+constexpr int64_t WARMUP_INTERVAL_NS = 100'000'000;
+
+enum BenchDeviceKind {
+    BENCH_MOUSE,
+    BENCH_KEYBOARD,
+    BENCH_GAMEPAD
+};
+
+struct BenchOptions {
+    std::string daemon = DEFAULT_DAEMON;
+    int devices = 1;
+    int rate = 1000; // events per second per device
+    double seconds = 5.0;
+    std::string type = "mouse"; // mouse, keyboard, gamepad or mixed
+    bool fake = false;
+    uint32_t capacity = 4096;
+    int poll_us = 100; // how often the consumer checks the ring, GD does it once per frame
+    double idle = 0.0; // s, > 0 -> measure wakeups with no input instead
+    bool verify = false; // sequence numbered events, checked for loss and reordering
+    std::vector<std::string> daemon_args;
+};
+
+struct BenchDevice {
+    BenchDeviceKind kind;
+    int write_fd = -1; // uinput fd, or the write end of the fake device's pipe
+    int read_fd = -1; // fake devices only, handed to the daemon
+    bool pressed = false;
+};
+
+int64_t now_ns() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return static_cast<int64_t>(t.tv_sec) * 1'000'000'000LL + t.tv_nsec;
+}
+
+void sleep_until(int64_t when) {
+    timespec t;
+    t.tv_sec = when / 1'000'000'000;
+    t.tv_nsec = when % 1'000'000'000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr) == EINTR) {}
+}
+
+uint16_t button_for(BenchDeviceKind kind) {
+    switch (kind) {
+    case BENCH_MOUSE: return BTN_LEFT;
+    case BENCH_KEYBOARD: return KEY_SPACE;
+    case BENCH_GAMEPAD: return BTN_SOUTH;
+    }
+    return BTN_LEFT;
+}
+
+bool create_uinput_device(BenchDevice& device, int index) {
+    int fd = open("/dev/uinput", O_WRONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    switch (device.kind) {
+    case BENCH_MOUSE:
+        ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
+        ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT);
+        ioctl(fd, UI_SET_EVBIT, EV_REL);
+        ioctl(fd, UI_SET_RELBIT, REL_X);
+        ioctl(fd, UI_SET_RELBIT, REL_Y);
+        break;
+    case BENCH_KEYBOARD:
+        // linux-input classifies anything with KEY_1 as a keyboard
+        for (int key = KEY_ESC; key <= KEY_SPACE; key++) ioctl(fd, UI_SET_KEYBIT, key);
+        break;
+    case BENCH_GAMEPAD: {
+        ioctl(fd, UI_SET_KEYBIT, BTN_SOUTH);
+        ioctl(fd, UI_SET_KEYBIT, BTN_EAST);
+        ioctl(fd, UI_SET_EVBIT, EV_ABS);
+        struct uinput_abs_setup abs{};
+        abs.absinfo.minimum = -32768;
+        abs.absinfo.maximum = 32767;
+        for (int code : { ABS_X, ABS_Y }) {
+            abs.code = code;
+            ioctl(fd, UI_ABS_SETUP, &abs);
+        }
+        break;
+    }
+    }
+
+    struct uinput_setup setup{};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0xcbf;
+    setup.id.product = 1 + device.kind;
+    snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "CBF bench device %d", index);
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) == -1 || ioctl(fd, UI_DEV_CREATE) == -1) {
+        close(fd);
+        return false;
+    }
+
+    device.write_fd = fd;
+    return true;
+}
+
+bool create_fake_device(BenchDevice& device) {
+    int fds[2];
+    if (pipe(fds) == -1) return false;
+    device.read_fd = fds[0];
+    device.write_fd = fds[1];
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+// A button press or release, followed by the SYN_REPORT that makes evdev hand it to readers
+bool inject(BenchDevice& device, bool fake) {
+    device.pressed = !device.pressed;
+
+    struct input_event events[2]{};
+    events[0].type = EV_KEY;
+    events[0].code = button_for(device.kind);
+    events[0].value = device.pressed;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+
+    // uinput timestamps events itself, fake devices have to do it here
+    if (fake) {
+        int64_t now = now_ns();
+        for (struct input_event& ev : events) {
+            ev.time.tv_sec = now / 1'000'000'000;
+            ev.time.tv_usec = (now % 1'000'000'000) / 1000;
+        }
+    }
+
+    return write(device.write_fd, events, sizeof(events)) == sizeof(events);
+}
+
+// `count` events carrying sequence numbers seq, seq + 1, ... on the axis numbered after the device, each in its own report.
+// EV_ABS goes through the daemon untouched on every device type with filtering off, and fake axes aren't rescaled.
+bool inject_sequence(BenchDevice& device, int index, uint32_t seq, uint32_t count) {
+    // pipe writes up to PIPE_BUF are atomic, bigger ones can be split mid-event and the daemon would read half of one
+    constexpr uint32_t BURST = PIPE_BUF / (2 * sizeof(struct input_event));
+    struct input_event events[BURST * 2]{};
+
+    int64_t now = now_ns();
+    for (uint32_t sent = 0; sent < count;) {
+        uint32_t n = std::min(BURST, count - sent);
+        for (uint32_t i = 0; i < n; i++) {
+            struct input_event* ev = &events[i * 2];
+            ev[0].type = EV_ABS;
+            ev[0].code = static_cast<uint16_t>(index);
+            ev[0].value = static_cast<int32_t>(seq + sent + i);
+            ev[1].type = EV_SYN;
+            ev[1].code = SYN_REPORT;
+            for (int j = 0; j < 2; j++) {
+                ev[j].time.tv_sec = now / 1'000'000'000;
+                ev[j].time.tv_usec = (now % 1'000'000'000) / 1000;
+            }
+        }
+
+        // the pipe blocks when the daemon falls behind, so nothing is lost before it reaches the daemon
+        size_t bytes = n * 2 * sizeof(struct input_event);
+        if (write(device.write_fd, events, bytes) != static_cast<ssize_t>(bytes)) return false;
+        sent += n;
+    }
+    return true;
+}
+
+SharedMemory* create_shared_memory(const std::string& path, uint32_t capacity, size_t& size) {
+    size = shm_size(capacity);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1 || ftruncate(fd, size) == -1) {
+        std::cerr << "Failed to create shared memory: " << strerror(errno) << std::endl;
+        if (fd != -1) close(fd);
+        return nullptr;
+    }
+
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Failed to mmap shared memory: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    SharedMemory* shm = static_cast<SharedMemory*>(memory);
+    shm->magic = SHM_MAGIC;
+    shm->version = SHM_VERSION;
+    shm->capacity = capacity;
+    shm->slot_size = sizeof(LinuxInputEvent);
+    return shm;
+}
+
+pid_t launch_daemon(const BenchOptions& options, const std::string& shm_path, const std::vector<BenchDevice>& devices) {
+    std::vector<std::string> args = { options.daemon, shm_path };
+    for (const BenchDevice& device : devices) {
+        if (device.read_fd == -1) continue;
+        static const char* type_names[] = { "mouse", "keyboard", "controller" };
+        args.push_back("--fake-device");
+        args.push_back(std::to_string(device.read_fd) + ":" + type_names[device.kind]);
+    }
+    args.insert(args.end(), options.daemon_args.begin(), options.daemon_args.end());
+
+    std::vector<char*> argv;
+    for (std::string& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(argv[0], argv.data());
+        std::cerr << "Failed to launch " << argv[0] << ": " << strerror(errno) << std::endl;
+        _exit(127);
+    }
+    return pid;
+}
+
+struct Consumer {
+    SharedMemory* shm = nullptr;
+    uint32_t tail = 0;
+    uint64_t consumed = 0;
+
+    // --verify, indexed by device
+    std::vector<uint32_t> next_seq;
+    uint64_t gaps = 0; // sequence numbers skipped over
+    uint64_t reordered = 0; // sequence numbers that went backwards or repeated
+    std::vector<int64_t> kernel_to_publish; // ns
+    std::vector<int64_t> end_to_end; // ns, kernel timestamp -> dequeued here
+
+    // Drain the ring like linuxCheckInputs does, keeping latencies only while recording
+    void poll(bool recording) {
+        uint32_t head = shm->head.load(std::memory_order_acquire);
+        if (head == tail) return;
+
+        int64_t now = now_ns();
+        const LinuxInputEvent* slots = shm_slots(shm);
+        for (; tail != head; tail++) {
+            const LinuxInputEvent& ev = slots[tail & (shm->capacity - 1)];
+            consumed++;
+            if (ev.type == EV_ABS && ev.code < next_seq.size()) {
+                uint32_t seq = static_cast<uint32_t>(ev.value);
+                uint32_t& expected = next_seq[ev.code];
+                if (seq < expected) reordered++;
+                else {
+                    gaps += seq - expected;
+                    expected = seq + 1;
+                }
+            }
+            if (recording && kernel_to_publish.size() < kernel_to_publish.capacity()) {
+                kernel_to_publish.push_back(ev.published - ev.time);
+                end_to_end.push_back(now - ev.time);
+            }
+        }
+        shm->tail.store(tail, std::memory_order_release);
+        shm->heartbeat.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+void print_percentiles(const char* name, std::vector<int64_t>& samples) {
+    if (samples.empty()) {
+        std::cout << name << ": no samples" << std::endl;
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        size_t index = std::min(samples.size() - 1, static_cast<size_t>(p / 100.0 * samples.size()));
+        return samples[index] / 1000.0;
+    };
+    printf("%s (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+        name, at(50), at(90), at(99), at(99.9), samples.back() / 1000.0);
+}
+
+// With nothing to read, the daemon should only wake up for its watchdog timer. Keeps the heartbeat going like GD
+// would, without reading the ring, so nothing on this side can wake the daemon up. Returns the exit code.
+int run_idle(const BenchOptions& options, SharedMemory* shm) {
+    // let the wakeups from startup (devices showing up, the first heartbeat) pass first
+    sleep_until(now_ns() + WARMUP_INTERVAL_NS);
+
+    uint32_t before = shm->wakeups.load(std::memory_order_relaxed);
+    int64_t end = now_ns() + static_cast<int64_t>(options.idle * 1e9);
+    while (now_ns() < end) {
+        shm->heartbeat.fetch_add(1, std::memory_order_relaxed);
+        sleep_until(std::min(end, now_ns() + WARMUP_INTERVAL_NS));
+    }
+    uint32_t wakeups = shm->wakeups.load(std::memory_order_relaxed) - before;
+
+    // a window of n periods can hold n + 1 watchdog ticks
+    uint32_t allowed = static_cast<uint32_t>(options.idle / SHM_WATCHDOG_SECS) + 1;
+    printf("idle for %.1fs: %u wakeups (%.2f/s), allowed %u\n", options.idle, wakeups, wakeups / options.idle, allowed);
+    if (wakeups > allowed) {
+        std::cerr << "linux-input woke up more often than its watchdog while idle" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+bool parse_bench_options(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--") {
+            options.daemon_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--daemon" && has_value) {
+            options.daemon = argv[++i];
+        } else if (arg == "--devices" && has_value) {
+            options.devices = atoi(argv[++i]);
+        } else if (arg == "--rate" && has_value) {
+            options.rate = atoi(argv[++i]);
+        } else if (arg == "--seconds" && has_value) {
+            options.seconds = atof(argv[++i]);
+        } else if (arg == "--type" && has_value) {
+            options.type = argv[++i];
+        } else if (arg == "--capacity" && has_value) {
+            options.capacity = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--poll-us" && has_value) {
+            options.poll_us = atoi(argv[++i]);
+        } else if (arg == "--idle" && has_value) {
+            options.idle = atof(argv[++i]);
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--fake") {
+            options.fake = true;
+        } else {
+            return false;
+        }
+    }
+
+    bool power_of_2 = (options.capacity & (options.capacity - 1)) == 0;
+    return options.devices > 0 && options.rate > 0 && (!options.verify || options.devices <= ABS_MT_SLOT) && options.seconds > 0 && options.poll_us >= 0 && options.idle >= 0
+        && power_of_2 && options.capacity >= SHM_MIN_CAPACITY && options.capacity <= SHM_MAX_CAPACITY
+        && (options.type == "mouse" || options.type == "keyboard" || options.type == "gamepad" || options.type == "mixed");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_bench_options(argc, argv, options)) {
+        std::cerr << "Usage: linux-input-bench [--daemon <path>] [--devices <n>] [--rate <events/s per device>]"
+            << " [--seconds <s>] [--type mouse|keyboard|gamepad|mixed] [--capacity <slots>] [--poll-us <us>] [--idle <s>] [--verify] [--fake]"
+            << " [-- <linux-input options>]" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchDevice> devices(options.devices);
+    bool fake = options.fake || options.verify; // uinput devices would need every axis set up, and evdev drops repeated values
+    for (int i = 0; i < options.devices; i++) {
+        BenchDevice& device = devices[i];
+        if (options.type == "mixed") device.kind = static_cast<BenchDeviceKind>(i % 3);
+        else if (options.type == "keyboard") device.kind = BENCH_KEYBOARD;
+        else if (options.type == "gamepad") device.kind = BENCH_GAMEPAD;
+        else device.kind = BENCH_MOUSE;
+
+        if (!fake && !create_uinput_device(device, i)) {
+            std::cerr << "uinput unavailable (" << strerror(errno) << "), using fake devices" << std::endl;
+            for (int j = 0; j < i; j++) close(devices[j].write_fd);
+            fake = true;
+            i = -1;
+            continue;
+        }
+        if (fake && !create_fake_device(device)) {
+            std::cerr << "Failed to create fake device: " << strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+
+    std::string shm_path = "/dev/shm/cbf-bench-" + std::to_string(getpid());
+    size_t shm_bytes;
+    SharedMemory* shm = create_shared_memory(shm_path, options.capacity, shm_bytes);
+    if (!shm) return 1;
+
+    pid_t daemon = launch_daemon(options, shm_path, devices);
+    for (BenchDevice& device : devices) {
+        if (device.read_fd != -1) close(device.read_fd);
+    }
+    if (daemon == -1) {
+        std::cerr << "Failed to fork: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    int64_t launched = now_ns();
+    while (shm->state.load(std::memory_order_acquire) != LINUX_INPUT_READY && now_ns() - launched < WARMUP_TIMEOUT_NS) {
+        sleep_until(now_ns() + 1'000'000);
+    }
+    printf("linux-input ready after %.1fms (probe %.1fms)\n",
+        (now_ns() - launched) / 1e6, shm->startup_us[STARTUP_PROBE] / 1000.0);
+
+    if (options.idle > 0) {
+        int result = run_idle(options, shm);
+        kill(daemon, SIGTERM);
+        waitpid(daemon, nullptr, 0);
+        for (BenchDevice& device : devices) close(device.write_fd);
+        munmap(shm, shm_bytes);
+        unlink(shm_path.c_str());
+        return result;
+    }
+
+    // Keep clicking every device until a whole round of clicks makes it through, in case the daemon
+    // reported ready before every uinput node had shown up and gotten its permissions
+    Consumer consumer;
+    consumer.shm = shm;
+    bool ready = false;
+    for (int64_t start = now_ns(); !ready && now_ns() - start < WARMUP_TIMEOUT_NS;) {
+        uint64_t before = consumer.consumed;
+        for (BenchDevice& device : devices) inject(device, fake);
+        sleep_until(now_ns() + WARMUP_INTERVAL_NS);
+        consumer.poll(false);
+        ready = consumer.consumed - before >= devices.size();
+    }
+    if (!ready) {
+        std::cerr << "linux-input never delivered events from every device" << std::endl;
+        kill(daemon, SIGTERM);
+        waitpid(daemon, nullptr, 0);
+        return 1;
+    }
+
+    if (options.verify) consumer.next_seq.assign(devices.size(), 0);
+    std::vector<uint32_t> sent_seq(devices.size(), 0);
+
+    uint64_t expected = static_cast<uint64_t>(options.rate * options.seconds) * devices.size();
+    consumer.kernel_to_publish.reserve(expected + 1024);
+    consumer.end_to_end.reserve(expected + 1024);
+    uint32_t dropped_before = shm->dropped.load(std::memory_order_relaxed);
+    uint64_t consumed_before = consumer.consumed;
+
+    std::atomic<bool> injecting{true};
+    uint64_t injected = 0;
+    std::thread injector([&]() {
+        int64_t period = 1'000'000'000LL / options.rate;
+        int64_t next = now_ns();
+        int64_t end = next + static_cast<int64_t>(options.seconds * 1e9);
+
+        if (options.verify) {
+            // in bursts of whatever is due every 100us, so the rate isn't limited by how fast this thread can sleep
+            int64_t start = next;
+            for (; next < end; next += 100'000) {
+                sleep_until(next);
+                uint32_t due = static_cast<uint32_t>((next - start) * static_cast<double>(options.rate) / 1e9);
+                for (size_t i = 0; i < devices.size(); i++) {
+                    if (due <= sent_seq[i]) continue;
+                    if (!inject_sequence(devices[i], static_cast<int>(i), sent_seq[i], due - sent_seq[i])) continue;
+                    injected += due - sent_seq[i];
+                    sent_seq[i] = due;
+                }
+            }
+            injecting.store(false, std::memory_order_release);
+            return;
+        }
+
+        for (; next < end; next += period) {
+            sleep_until(next);
+            for (BenchDevice& device : devices) {
+                if (inject(device, fake)) injected++;
+            }
+        }
+        injecting.store(false, std::memory_order_release);
+    });
+
+    int64_t start = now_ns();
+    while (injecting.load(std::memory_order_acquire)) {
+        consumer.poll(true);
+        if (options.poll_us > 0) sleep_until(now_ns() + options.poll_us * 1000LL);
+    }
+    injector.join();
+    double elapsed = (now_ns() - start) / 1e9;
+
+    // let whatever is still in flight arrive, the daemon can be a long way behind the injector at high rates
+    for (int64_t drain_end = now_ns() + 100'000'000; now_ns() < drain_end;) {
+        uint64_t before = consumer.consumed;
+        consumer.poll(true);
+        if (consumer.consumed != before) drain_end = now_ns() + 100'000'000;
+        sleep_until(now_ns() + 1'000'000);
+    }
+
+    uint64_t delivered = consumer.consumed - consumed_before;
+    uint32_t dropped = shm->dropped.load(std::memory_order_relaxed) - dropped_before;
+
+    printf("%d %s device(s) (%s) at %d events/s for %.1fs, ring %u slots, polled every %dus\n",
+        options.devices, options.type.c_str(), fake ? "fake" : "uinput", options.rate, options.seconds,
+        options.capacity, options.poll_us);
+    printf("injected %llu, delivered %llu (%.0f/s), dropped %u\n",
+        static_cast<unsigned long long>(injected), static_cast<unsigned long long>(delivered), delivered / elapsed, dropped);
+    print_percentiles("kernel->publish", consumer.kernel_to_publish);
+    print_percentiles("end to end", consumer.end_to_end);
+
+    // every event lost has to be one the full ring reported dropping, anything else went missing in the daemon
+    int result = 0;
+    if (options.verify) {
+        uint64_t lost = consumer.gaps;
+        for (size_t i = 0; i < devices.size(); i++) lost += sent_seq[i] - consumer.next_seq[i];
+        printf("verify: %llu lost, %llu out of order, %u dropped by the full ring\n",
+            static_cast<unsigned long long>(lost), static_cast<unsigned long long>(consumer.reordered), dropped);
+        if (consumer.reordered > 0 || lost != dropped) {
+            std::cerr << "linux-input lost or reordered events" << std::endl;
+            result = 1;
+        }
+    }
+
+    kill(daemon, SIGTERM);
+    waitpid(daemon, nullptr, 0);
+    for (BenchDevice& device : devices) close(device.write_fd);
+    munmap(shm, shm_bytes);
+    unlink(shm_path.c_str());
+    return result;
+}
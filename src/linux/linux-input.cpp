@@ -1,6 +1,9 @@
 #include <libevdev-1.0/libevdev/libevdev.h>
 #include <linux/input-event-codes.h>
 
+#include "../linuxshm.hpp"
+#include "trace.hpp"
+
 #include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
@@ -9,57 +12,234 @@
 #include <sys/ioctl.h>
 #include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <poll.h>
 
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 #include <cstdint>
+#include <climits>
 #include <string>
 #include <vector>
 #include <atomic>
+#include <chrono>
 #include <array>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <system_error>
 #include <algorithm>
 
-enum DeviceType : int8_t {
-    MOUSE,
-    TOUCHPAD,
-    KEYBOARD,
-    TOUCHSCREEN,
-    CONTROLLER,
-    UNKNOWN
+// io_uring is driven through the raw syscalls so the daemon doesn't grow a liburing dependency
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define CBF_IO_URING
+#endif
+#endif
+
+constexpr int MAX_EVENTS = 10;
+constexpr int READ_BATCH_SIZE = 64;
+constexpr int WATCHDOG_TIMEOUT_SECS = SHM_WATCHDOG_SECS;
+constexpr int64_t CALIBRATION_INTERVAL_NS = 1'000'000'000;
+constexpr int64_t CLOCK_WATCH_NS = 365LL * 24 * 3600 * 1'000'000'000; // the clock watch only needs to outlive the session
+
+constexpr const char* INPUT_DIR = "/dev/input/";
+
+constexpr int REALTIME_PRIORITY = 10; // low, just enough to preempt normal desktop load
+constexpr int FALLBACK_NICE = -10;
+
+constexpr size_t MAX_PROBE_THREADS = 8;
+constexpr int64_t SLOW_PROBE_MS = 100;
+
+constexpr int64_t REPLAY_ARM_POLL_NS = 10'000'000; // how often to check whether GD is ready for a replay to start
+
+constexpr unsigned URING_ENTRIES = 256;
+constexpr uint64_t URING_CONTROL = 1; // user_data of the poll on the epoll fd holding the non-device sources
+constexpr uint64_t URING_POLL_BIT = 1; // set in a device's user_data for the poll in front of a retried read
+
+// Pair of clock readings taken back to back, used to convert between the two domains
+struct ClockCalibration {
+    int64_t monotonic; // ns
+    int64_t realtime; // ns since the unix epoch
 };
 
-struct __attribute__((packed)) LinuxInputEvent {
-    int64_t time;
-    uint16_t type;
-    uint16_t code;
-    int32_t value;
-    DeviceType deviceType;
+// Integer coefficients for mapping a raw axis value onto the range GD expects
+struct AxisScale {
+    int32_t raw_min;
+    int32_t out_min;
+    int64_t factor; // 16.16 fixed point
 };
 
-constexpr size_t RING_BUFFER_SIZE = 256;
+// Everything the hot loop needs to know about a device, computed once when it's added
+struct InputDevice {
+    struct libevdev* dev = nullptr;
+    int fd = -1;
+    std::string path;
+    DeviceType type = UNKNOWN;
+    bool realtime_clock = false; // EVIOCSCLOCKID isn't supported, timestamps need converting
+    std::array<AxisScale, ABS_CNT> axes{};
+    std::array<int8_t, ABS_CNT> axis_zones{}; // which side of GD's threshold each axis was last on
+
+    // State as of the last event read. Reads bypass libevdev, so its own copy of the state is stale,
+    // this is what a resync after SYN_DROPPED compares the kernel's state against.
+    std::array<uint8_t, (KEY_CNT + 7) / 8> key_state{}; // bit per key, same layout as EVIOCGKEY
+    std::array<int32_t, ABS_CNT> abs_state{};
+    std::vector<uint16_t> abs_codes; // axes the device has, apart from the multitouch ones
+    bool dropping = false; // got a SYN_DROPPED, everything up to the next SYN_REPORT is incomplete
 
-struct __attribute__((packed)) SharedMemory {
-    volatile uint32_t head;
-    volatile uint32_t tail;
-    volatile uint32_t error_flag;
-    volatile uint32_t heartbeat;
-    LinuxInputEvent events[RING_BUFFER_SIZE];
+    // io_uring backend only: the kernel reads straight into read_buffer, so it has to outlive every request in flight
+    std::array<struct input_event, READ_BATCH_SIZE> read_buffer;
+    struct iovec read_iov{};
+    int uring_pending = 0;
+    bool retired = false;
+
+    ~InputDevice() {
+        if (dev) libevdev_free(dev);
+        if (fd != -1) close(fd);
+    }
 };
 
-constexpr int MAX_EVENTS = 10;
-constexpr int WATCHDOG_TIMEOUT_SECS = 5;
+using DeviceRegistry = std::unordered_map<std::string, std::unique_ptr<InputDevice>>;
+
+// epoll tags for the fds that aren't input devices (devices store their InputDevice* instead)
+enum EpollSource : uint64_t {
+    SOURCE_INOTIFY = 1,
+    SOURCE_WATCHDOG,
+    SOURCE_SIGNAL,
+    SOURCE_REPLAY,
+    SOURCE_CLOCK
+};
+
+bool is_control_source(uint64_t data) {
+    return data <= SOURCE_CLOCK;
+}
+
+#ifdef CBF_IO_URING
+// Submission and completion rings mapped from an io_uring instance
+struct IoUring {
+    int fd = -1;
+    unsigned sq_entries = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    struct io_uring_sqe* sqes = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    struct io_uring_cqe* cqes = nullptr;
+
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    void* sqe_array = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    size_t sqe_array_size = 0;
+
+    unsigned sq_local_tail = 0; // SQEs filled in but not yet handed to the kernel
+    unsigned to_submit = 0;
+
+    std::vector<std::unique_ptr<InputDevice>> retired; // removed devices whose reads haven't completed yet
+};
+#else
+struct IoUring {};
+#endif
+
+// A trace being fed into the ring instead of real devices
+struct Replay {
+    const TraceRecord* records = nullptr;
+    size_t count = 0;
+    size_t next = 0;
+    double speed = 1.0;
+    bool started = false;
+    int64_t origin = 0; // trace time of the first record
+    int64_t base = 0; // monotonic time the first record is replayed at
+    int timer_fd = -1;
+};
+
+// State shared by the epoll and io_uring loops
+struct Daemon {
+    SharedMemory* shm = nullptr;
+    DeviceRegistry devices;
+    int epoll_fd = -1; // holds every source with the epoll backend, only the non-device ones with io_uring
+    int inotify_fd = -1;
+    int watchdog_fd = -1;
+    int signal_fd = -1;
+    int clock_fd = -1; // CLOCK_REALTIME timer that gets cancelled when the clock is set
+    IoUring* uring = nullptr; // null -> devices are polled through epoll
+    Replay* replay = nullptr; // non-null -> no devices, events come from a trace
+
+    // Don't start counting until GD has incremented the heartbeat at least once,
+    // since GD may take a long time to finish loading.
+    uint32_t last_heartbeat = 0;
+    bool heartbeat_started = false;
+    bool should_quit = false;
+    uint64_t wakeups = 0;
+
+    int record_fd = -1; // --record, everything published gets appended here
+    std::vector<TraceRecord> record_buffer;
+};
+
+
+struct FakeDevice {
+    int fd;
+    DeviceType type;
+};
+
+struct Options {
+    std::string shm_path;
+    bool realtime = false;
+    std::string cpus; // affinity list like "2,3" or "4-7", empty -> don't pin
+    bool io_uring = false;
+    std::string record_path;
+    std::string replay_path;
+    double replay_speed = 1.0;
+    std::vector<FakeDevice> fake_devices;
+};
 
 #define INOTIFY_EVENT_SIZE  ( sizeof (struct inotify_event) )
 #define INOTIFY_BUF_LEN     ( 1024 * ( INOTIFY_EVENT_SIZE + 16 ) )
 
-std::atomic<bool> should_quit{false};
+int64_t realtime_offset = 0; // realtime - monotonic as of the last calibration, ns
+
+int64_t timespec_to_ns(const timespec& t) {
+    return static_cast<int64_t>(t.tv_sec) * 1'000'000'000LL + t.tv_nsec;
+}
+
+ClockCalibration sample_clocks() {
+    // read monotonic on both sides of realtime and use the midpoint to halve the sampling error
+    timespec before, realtime, after;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &after);
 
-void stop(int) {
-    should_quit.store(true);
+    int64_t before_ns = timespec_to_ns(before);
+    return { before_ns + (timespec_to_ns(after) - before_ns) / 2, timespec_to_ns(realtime) };
 }
 
-int64_t convert_time(timeval t) {
-    return ((static_cast<int64_t>(t.tv_sec) + 11644473600LL) * 10000000LL) + (t.tv_usec * 10);
+void publish_calibration(SharedMemory* shm, const ClockCalibration& calibration) {
+    realtime_offset = calibration.realtime - calibration.monotonic;
+
+    uint32_t seq = shm->clock_seq.load(std::memory_order_relaxed);
+    shm->clock_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    shm->clock_monotonic.store(calibration.monotonic, std::memory_order_relaxed);
+    // unix epoch ns -> FILETIME
+    shm->clock_realtime.store((calibration.realtime / 100) + 11644473600LL * 10000000LL, std::memory_order_relaxed);
+    shm->clock_seq.store(seq + 2, std::memory_order_release);
+}
+
+int64_t convert_time(const InputDevice& device, timeval t) {
+    int64_t ns = static_cast<int64_t>(t.tv_sec) * 1'000'000'000LL + static_cast<int64_t>(t.tv_usec) * 1000;
+    return device.realtime_clock ? ns - realtime_offset : ns;
 }
 
 uint16_t convert_scan_code(uint16_t code) {
@@ -88,286 +268,1272 @@ uint16_t convert_scan_code(uint16_t code) {
     return (code > 96) && (code < 116) ? special_codes[code - 96] : code;
 }
 
-void add_input_device(std::string path, int epoll_fd, std::vector<struct libevdev*> &devices, std::vector<std::string> &devices_paths){
-    int fd = open(path.c_str(), O_RDONLY);
+DeviceType classify_device(struct libevdev* dev) {
+    if (libevdev_has_event_code(dev, EV_KEY, KEY_1)) return KEYBOARD;
+    if (libevdev_has_property(dev, INPUT_PROP_DIRECT)) return TOUCHSCREEN;
+    if (libevdev_has_property(dev, INPUT_PROP_BUTTONPAD)) return TOUCHPAD;
+    if (libevdev_has_event_code(dev, EV_KEY, BTN_GAMEPAD)) return CONTROLLER;
+    return UNKNOWN;
+}
+
+AxisScale make_axis_scale(struct libevdev* dev, int code, int32_t min, int32_t max) {
+    AxisScale scale{};
+    scale.out_min = min;
+    if (!libevdev_has_event_code(dev, EV_ABS, code)) return scale;
+
+    int abs_min = libevdev_get_abs_minimum(dev, code);
+    int abs_max = libevdev_get_abs_maximum(dev, code);
+    if (abs_max <= abs_min) return scale;
+
+    scale.raw_min = abs_min;
+    scale.factor = (static_cast<int64_t>(max - min) << 16) / (static_cast<int64_t>(abs_max) - abs_min);
+    return scale;
+}
+
+int32_t normalize_axis(const AxisScale& scale, int32_t val) {
+    return static_cast<int32_t>(((static_cast<int64_t>(val) - scale.raw_min) * scale.factor) >> 16) + scale.out_min;
+}
+
+#ifdef CBF_IO_URING
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+void destroy_io_uring(IoUring& ring) {
+    if (ring.sqe_array != MAP_FAILED) munmap(ring.sqe_array, ring.sqe_array_size);
+    if (ring.cq_ring != MAP_FAILED && ring.cq_ring != ring.sq_ring) munmap(ring.cq_ring, ring.cq_ring_size);
+    if (ring.sq_ring != MAP_FAILED) munmap(ring.sq_ring, ring.sq_ring_size);
+    if (ring.fd != -1) close(ring.fd); // cancels whatever is still in flight
+    ring.sqe_array = ring.cq_ring = ring.sq_ring = MAP_FAILED;
+    ring.fd = -1;
+    ring.retired.clear();
+}
+
+// Fails on kernels older than 5.1 or where io_uring has been disabled, the caller falls back to epoll
+bool setup_io_uring(IoUring& ring) {
+    struct io_uring_params params{};
+    ring.fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        std::cerr << "[CBF] io_uring is unavailable: " << strerror(errno) << std::endl;
+        ring.fd = -1;
+        return false;
+    }
+
+    ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring.sqe_array_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) ring.sq_ring_size = ring.cq_ring_size = std::max(ring.sq_ring_size, ring.cq_ring_size);
+
+    ring.sq_ring = mmap(NULL, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ring != MAP_FAILED) {
+        ring.cq_ring = single_mmap ? ring.sq_ring
+            : mmap(NULL, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    }
+    if (ring.cq_ring != MAP_FAILED) {
+        ring.sqe_array = mmap(NULL, ring.sqe_array_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    }
+    if (ring.sqe_array == MAP_FAILED) {
+        std::cerr << "[CBF] Failed to mmap io_uring: " << strerror(errno) << std::endl;
+        destroy_io_uring(ring);
+        return false;
+    }
+
+    char* sq = static_cast<char*>(ring.sq_ring);
+    ring.sq_entries = params.sq_entries;
+    ring.sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring.sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring.sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring.sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring.sqes = static_cast<struct io_uring_sqe*>(ring.sqe_array);
+
+    char* cq = static_cast<char*>(ring.cq_ring);
+    ring.cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring.cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring.cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring.cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    ring.sq_local_tail = *ring.sq_tail;
+    return true;
+}
+
+// Hand every queued SQE to the kernel, and block until at least min_complete completions are ready
+int uring_enter(IoUring& ring, unsigned min_complete) {
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+    int ret = sys_io_uring_enter(ring.fd, ring.to_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+    if (ret > 0) ring.to_submit -= ret;
+    return ret;
+}
+
+// Make sure the next `count` SQEs can be taken without the submission queue overflowing
+bool uring_reserve(IoUring& ring, unsigned count) {
+    if (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) + count <= ring.sq_entries) return true;
+    if (uring_enter(ring, 0) < 0) return false;
+    return ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) + count <= ring.sq_entries;
+}
+
+struct io_uring_sqe* uring_get_sqe(IoUring& ring) {
+    unsigned index = ring.sq_local_tail & *ring.sq_mask;
+    struct io_uring_sqe* sqe = &ring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[index] = index;
+    ring.sq_local_tail++;
+    ring.to_submit++;
+    return sqe;
+}
+
+// Keep one read outstanding per device. When the last one found the queue empty, it gets linked behind a poll
+// so the read only runs once there is data, whether or not the kernel can wait on an O_NONBLOCK fd by itself.
+bool uring_queue_read(IoUring& ring, InputDevice& device, bool wait_for_data) {
+    if (!uring_reserve(ring, wait_for_data ? 2 : 1)) {
+        std::cerr << "[CBF] Failed to queue a read for " << device.path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (wait_for_data) {
+        struct io_uring_sqe* poll = uring_get_sqe(ring);
+        poll->opcode = IORING_OP_POLL_ADD;
+        poll->fd = device.fd;
+        poll->poll_events = POLLIN;
+        poll->flags = IOSQE_IO_LINK;
+        poll->user_data = reinterpret_cast<uint64_t>(&device) | URING_POLL_BIT;
+        device.uring_pending++;
+    }
+
+    device.read_iov.iov_base = device.read_buffer.data();
+    device.read_iov.iov_len = sizeof(device.read_buffer);
+
+    struct io_uring_sqe* read = uring_get_sqe(ring);
+    read->opcode = IORING_OP_READV;
+    read->fd = device.fd;
+    read->addr = reinterpret_cast<uint64_t>(&device.read_iov);
+    read->len = 1;
+    read->user_data = reinterpret_cast<uint64_t>(&device);
+    device.uring_pending++;
+    return true;
+}
+
+bool uring_queue_control_poll(IoUring& ring, int epoll_fd) {
+    if (!uring_reserve(ring, 1)) return false;
+    struct io_uring_sqe* poll = uring_get_sqe(ring);
+    poll->opcode = IORING_OP_POLL_ADD;
+    poll->fd = epoll_fd;
+    poll->poll_events = POLLIN;
+    poll->user_data = URING_CONTROL;
+    return true;
+}
+
+// Unplugging a device completes its read with ENODEV, the device is freed once that has come back
+void uring_retire_device(IoUring& ring, std::unique_ptr<InputDevice> device) {
+    if (device->uring_pending == 0) return;
+    device->retired = true;
+    ring.retired.push_back(std::move(device));
+}
+
+void uring_release_device(IoUring& ring, InputDevice* device) {
+    ring.retired.erase(std::remove_if(ring.retired.begin(), ring.retired.end(),
+        [device](const std::unique_ptr<InputDevice>& retired) { return retired.get() == device; }), ring.retired.end());
+}
+#else
+bool setup_io_uring(IoUring&) {
+    std::cerr << "[CBF] Built without io_uring support" << std::endl;
+    return false;
+}
+
+void destroy_io_uring(IoUring&) {}
+bool uring_queue_read(IoUring&, InputDevice&, bool) { return false; }
+void uring_retire_device(IoUring&, std::unique_ptr<InputDevice>) {}
+#endif
+
+void watch_device(Daemon& d, std::unique_ptr<InputDevice> device) {
+    if (d.uring) {
+        if (!uring_queue_read(*d.uring, *device, false)) return;
+    } else {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = device.get();
+        if (epoll_ctl(d.epoll_fd, EPOLL_CTL_ADD, device->fd, &ev) == -1) {
+            std::cerr << "[CBF] Failed to add fd to epoll for " << device->path << ": " << strerror(errno) << std::endl;
+            return;
+        }
+    }
+
+    std::cerr << "[CBF] Added device: " << device->path << std::endl;
+    std::string path = device->path;
+    d.devices.emplace(path, std::move(device));
+}
+
+// Query the kernel's current key and axis state for a device
+bool read_device_state(const InputDevice& device, std::array<uint8_t, (KEY_CNT + 7) / 8>& keys, std::array<int32_t, ABS_CNT>& abs) {
+    keys.fill(0);
+    if (ioctl(device.fd, EVIOCGKEY(keys.size()), keys.data()) < 0) {
+        std::cerr << "[CBF] Failed to read key state of " << device.path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    for (uint16_t code : device.abs_codes) {
+        struct input_absinfo info;
+        if (ioctl(device.fd, EVIOCGABS(code), &info) < 0) {
+            std::cerr << "[CBF] Failed to read axis state of " << device.path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        abs[code] = info.value;
+    }
+    return true;
+}
+
+// Open a device and work out everything the hot loop needs to know about it, returns null if it should be ignored.
+// Only touches the device itself, so several can be probed at once.
+std::unique_ptr<InputDevice> probe_device(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
     if (fd == -1) {
         // We ignore errno if its 2 because when a device is disconnected, an IN_ATTRIB signal will still be sent,
         // causing it to try to add the now deleted device. And we ignore errno 13 because it means that the IN_ATTRIB
         // signal that we catched is not the right one and we can't access the device yet. More information below.
-        if(errno == 2 || errno == 13) return;
+        if(errno == 2 || errno == 13) return nullptr;
         std::cerr << "[CBF] Failed to open " << path << ": " << strerror(errno) << std::endl;
-        return;
+        return nullptr;
     }
 
-    libevdev* dev = nullptr;
-    int rc = libevdev_new_from_fd(fd, &dev);
+    std::unique_ptr<InputDevice> device(new InputDevice());
+    device->fd = fd;
+    device->path = path;
+
+    int rc = libevdev_new_from_fd(fd, &device->dev);
     if (rc < 0) {
         std::cerr << "[CBF] Failed to create evdev device for " << path << ": " << strerror(-rc) << std::endl;
-        close(fd);
-        return;
+        return nullptr;
     }
 
-    int bus = libevdev_get_id_bustype(dev);
-    if (bus == BUS_USB || bus == BUS_BLUETOOTH || bus == BUS_I8042 || bus == BUS_VIRTUAL) {
-        epoll_event ev;
-        ev.events = EPOLLIN;
-        ev.data.ptr = dev;
-        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
-            std::cerr << "[CBF] Failed to add fd to epoll for " << path << ": " << strerror(errno) << std::endl;
-            libevdev_free(dev);
-            close(fd);
-            return;
+    int bus = libevdev_get_id_bustype(device->dev);
+    if (bus != BUS_USB && bus != BUS_BLUETOOTH && bus != BUS_I8042 && bus != BUS_VIRTUAL) return nullptr;
+
+    // timestamp events with CLOCK_MONOTONIC so NTP adjustments can't reorder them relative to GD's frames
+    if (libevdev_set_clock_id(device->dev, CLOCK_MONOTONIC) != 0) {
+        std::cerr << "[CBF] Failed to set monotonic clock for " << path << ", converting from realtime" << std::endl;
+        device->realtime_clock = true;
+    }
+
+    // the multitouch axes are per slot, EVIOCGABS only reports the current one
+    for (uint16_t code = 0; code < ABS_MT_SLOT; code++) {
+        if (libevdev_has_event_code(device->dev, EV_ABS, code)) device->abs_codes.push_back(code);
+    }
+    read_device_state(*device, device->key_state, device->abs_state);
+
+    device->type = classify_device(device->dev);
+    if (device->type == CONTROLLER) {
+        for (int code = 0; code < ABS_CNT; code++) {
+            if (code == ABS_Z || code == ABS_RZ) device->axes[code] = make_axis_scale(device->dev, code, 0, 255);
+            else device->axes[code] = make_axis_scale(device->dev, code, -32768, 32767);
         }
+    }
 
-        devices.push_back(dev);
-        devices_paths.push_back(path);
-        std::cerr << "[CBF] Added device: " << path << std::endl;
-    } else {
-        libevdev_free(dev);
-        close(fd);
+    return device;
+}
+
+void add_input_device(Daemon& d, std::string path){
+    if (d.devices.count(path)) return; // IN_ATTRIB can fire more than once for the same device
+
+    std::unique_ptr<InputDevice> device = probe_device(path);
+    if (device) watch_device(d, std::move(device));
+}
+
+// Some HID nodes take a long time to answer when they're opened or queried,
+// so the startup scan probes devices on a few threads instead of one after another
+std::vector<std::unique_ptr<InputDevice>> probe_devices(const std::vector<std::string>& paths) {
+    std::vector<std::unique_ptr<InputDevice>> devices(paths.size());
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < paths.size();) {
+            auto start = std::chrono::steady_clock::now();
+            devices[i] = probe_device(paths[i]);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            if (elapsed.count() >= SLOW_PROBE_MS) {
+                std::cerr << "[CBF] Probing " << paths[i] << " took " << elapsed.count() << "ms" << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t thread_count = std::min<size_t>(paths.size(), MAX_PROBE_THREADS);
+    for (size_t i = 1; i < thread_count; i++) {
+        try {
+            threads.emplace_back(worker);
+        } catch (const std::system_error&) {
+            break; // whatever threads did start (and this one) still get through every path
+        }
     }
+    worker();
+    for (std::thread& thread : threads) thread.join();
+
+    return devices;
+}
+
+// Stand-in for a real device, fed input_events through a pipe or socket by a benchmark
+void add_fake_device(Daemon& d, const FakeDevice& fake) {
+    int flags = fcntl(fake.fd, F_GETFL);
+    if (flags == -1 || fcntl(fake.fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        std::cerr << "[CBF] Invalid fake device fd " << fake.fd << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    std::unique_ptr<InputDevice> device(new InputDevice());
+    device->fd = fake.fd;
+    device->path = "fake:" + std::to_string(fake.fd);
+    device->type = fake.type;
+    for (AxisScale& scale : device->axes) scale.factor = 1 << 16; // values are already in GD's range
+    watch_device(d, std::move(device));
 }
 
-void remove_input_device(std::string path, std::vector<struct libevdev*> &devices, std::vector<std::string> &devices_paths){
-    auto finder = std::find(devices_paths.begin(), devices_paths.end(), path);
-    int index = std::distance(devices_paths.begin(), finder);
-    if(finder == devices_paths.end()){
+void remove_input_device(Daemon& d, std::string path){
+    auto it = d.devices.find(path);
+    if (it == d.devices.end()) {
         std::cerr << "[CBF] Input device scheduled to be removed was not found." << std::endl;
         return;
     }
 
-    close(libevdev_get_fd(devices[index]));
-    libevdev_free(devices[index]);
-    devices.erase(devices.begin() + index);
-    devices_paths.erase(devices_paths.begin() + index);
+    if (d.uring) uring_retire_device(*d.uring, std::move(it->second));
+    d.devices.erase(it);
 
     std::cerr << "[CBF] Removed device: " << path << std::endl;
 }
 
-int32_t normalize_axis(struct libevdev* dev, int code, int val, int min, int max) {
-    int abs_min = libevdev_get_abs_minimum(dev, code);
-    int abs_max = libevdev_get_abs_maximum(dev, code);
-    float normalized = static_cast<float>(val - abs_min) / static_cast<float>(abs_max - abs_min);
-    int32_t scaled = static_cast<int32_t>(normalized * (max - min)) + min;
-    return scaled;
+// Which side of the threshold GD uses for an axis the value is on (-1, 0, 1), or AXIS_UNUSED if GD ignores the axis
+constexpr int8_t AXIS_UNUSED = INT8_MIN;
+
+int8_t axis_zone(const SharedMemory* shm, uint16_t code, int32_t value) {
+    int32_t deadzone;
+    switch (code) {
+    case ABS_X:
+    case ABS_Y:
+        deadzone = shm->left_stick_deadzone.load(std::memory_order_relaxed);
+        break;
+    case ABS_RX:
+    case ABS_RY:
+        deadzone = shm->right_stick_deadzone.load(std::memory_order_relaxed);
+        break;
+    case ABS_HAT0X:
+    case ABS_HAT0Y:
+        deadzone = shm->hat_deadzone.load(std::memory_order_relaxed);
+        break;
+    case ABS_Z:
+    case ABS_RZ:
+        return value > shm->trigger_threshold.load(std::memory_order_relaxed) ? 1 : 0;
+    default:
+        return AXIS_UNUSED;
+    }
+
+    if (value < -deadzone) return -1;
+    if (value > deadzone) return 1;
+    return 0;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "[CBF] Usage: linux-input <shm_path>" << std::endl;
-        return 1;
+// Returns false if the event isn't relevant to GD and shouldn't be published
+bool translate_event(InputDevice& device, const SharedMemory* shm, const input_event& ev, LinuxInputEvent& out) {
+    if (ev.type != EV_ABS && (ev.type != EV_KEY || ev.value == 2)) {
+        return false;
     }
 
-    std::string shm_path = argv[1];
-    std::cerr << "[CBF] Linux input program started, shm: " << shm_path << std::endl;
+    uint16_t code = ev.code;
+    int32_t value = ev.value;
+    DeviceType device_type = device.type;
+    bool filter = shm->filter_active.load(std::memory_order_relaxed);
+
+    if (ev.code == BTN_LEFT || ev.code == BTN_RIGHT) {
+        device_type = MOUSE;
+    }
+    else if (device_type == KEYBOARD) {
+        code = convert_scan_code(ev.code);
+    }
+    else if (device_type == CONTROLLER && ev.type == EV_ABS && ev.code < ABS_CNT) {
+        value = normalize_axis(device.axes[ev.code], value);
 
+        // only threshold crossings matter to GD, raw stick movement doesn't
+        if (filter) {
+            int8_t zone = axis_zone(shm, ev.code, value);
+            if (zone == AXIS_UNUSED || zone == device.axis_zones[ev.code]) return false;
+            device.axis_zones[ev.code] = zone;
+        }
+    }
+
+    if (filter) {
+        if (!shm->armed.load(std::memory_order_relaxed)) return false;
+        if (ev.type == EV_ABS && device_type != CONTROLLER) return false;
+        if (ev.type == EV_KEY && !shm_code_bound(shm, code)) return false;
+    }
+
+    out.time = convert_time(device, ev.time);
+    out.type = ev.type;
+    out.code = code;
+    out.value = value;
+    out.deviceType = device_type;
+    return true;
+}
+
+// Write an event into the ring without publishing it, the caller stores the new head afterwards
+void write_slot(SharedMemory* shm, const LinuxInputEvent& event, uint32_t& head, uint32_t& tail) {
+    if (head - tail >= shm->capacity) {
+        tail = shm->tail.load(std::memory_order_acquire);
+        if (head - tail >= shm->capacity) { // buffer full, drop event
+            shm->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    shm_slots(shm)[head & (shm->capacity - 1)] = event;
+    head++;
+}
+
+void push_event(SharedMemory* shm, InputDevice& device, const input_event& ev, uint32_t& head, uint32_t& tail) {
+    LinuxInputEvent event;
+    if (translate_event(device, shm, ev, event)) write_slot(shm, event, head, tail);
+}
+
+// After a SYN_DROPPED, ask the kernel for the device's current state and publish whatever differs from the state
+// the dropped events would have left it in, as if it all happened at `time` (the SYN_REPORT that ended the gap)
+void resync_device(InputDevice& device, SharedMemory* shm, const timeval& time, uint32_t& head, uint32_t& tail) {
+    if (!device.dev) return; // fake devices have no kernel state to query
+
+    std::array<uint8_t, (KEY_CNT + 7) / 8> keys;
+    std::array<int32_t, ABS_CNT> abs = device.abs_state;
+    if (!read_device_state(device, keys, abs)) return;
+
+    struct input_event ev{};
+    ev.time = time;
+
+    ev.type = EV_KEY;
+    for (size_t byte = 0; byte < keys.size(); byte++) {
+        uint8_t changed = keys[byte] ^ device.key_state[byte];
+        for (int bit = 0; changed; bit++, changed >>= 1) {
+            if (!(changed & 1)) continue;
+            ev.code = static_cast<uint16_t>(byte * 8 + bit);
+            ev.value = (keys[byte] >> bit) & 1;
+            push_event(shm, device, ev, head, tail);
+        }
+    }
+    device.key_state = keys;
+
+    ev.type = EV_ABS;
+    for (uint16_t code : device.abs_codes) {
+        if (abs[code] == device.abs_state[code]) continue;
+        ev.code = code;
+        ev.value = abs[code];
+        push_event(shm, device, ev, head, tail);
+    }
+    device.abs_state = abs;
+}
+
+// Keep the tracked state up to date, returns false for key events that don't change it
+bool track_state(InputDevice& device, const input_event& ev) {
+    if (ev.type == EV_KEY && ev.code < KEY_CNT && ev.value != 2) {
+        uint8_t& byte = device.key_state[ev.code / 8];
+        uint8_t bit = static_cast<uint8_t>(1 << (ev.code % 8));
+        if (((byte & bit) != 0) == (ev.value != 0)) return false; // already reported by a resync
+        byte ^= bit;
+    }
+    else if (ev.type == EV_ABS && ev.code < ABS_CNT) {
+        device.abs_state[ev.code] = ev.value;
+    }
+    return true;
+}
+
+// Shared by both backends. A SYN_DROPPED discards events up to the next SYN_REPORT, which resyncs the device,
+// and everything after that in the batch is published as usual
+void publish_events(InputDevice& device, SharedMemory* shm, const input_event* events, size_t count, uint32_t& head, uint32_t& tail) {
+    for (size_t i = 0; i < count; i++) {
+        const input_event& ev = events[i];
+        if (ev.type == EV_SYN && ev.code == SYN_DROPPED) {
+            device.dropping = true;
+            continue;
+        }
+        if (device.dropping) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                device.dropping = false;
+                resync_device(device, shm, ev.time, head, tail);
+            }
+            continue;
+        }
+        if (track_state(device, ev)) push_event(shm, device, ev, head, tail);
+    }
+}
+
+// Read every queued event on a device in as few syscalls as possible
+void drain_device(InputDevice& device, SharedMemory* shm, uint32_t& head, uint32_t& tail) {
+    struct input_event buffer[READ_BATCH_SIZE];
+
+    while (true) {
+        ssize_t len = read(device.fd, buffer, sizeof(buffer));
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != ENODEV) {
+                std::cerr << "[CBF] Error reading event: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        size_t count = len / sizeof(struct input_event);
+        publish_events(device, shm, buffer, count, head, tail);
+        if (count < READ_BATCH_SIZE) return; // the kernel queue is empty
+    }
+}
+
+void handle_inotify(Daemon& d) {
+    char inotify_buffer[INOTIFY_BUF_LEN];
+
+    int inotify_len;
+    while ((inotify_len = read(d.inotify_fd, inotify_buffer, INOTIFY_BUF_LEN)) > 0) {
+        int i = 0;
+
+        while(i < inotify_len){
+            struct inotify_event *event = ( struct inotify_event * ) &inotify_buffer[ i ];
+            i += INOTIFY_EVENT_SIZE + event->len;
+
+            if(event->len) {
+                std::string device_name = std::string(event->name);
+                std::string path = std::string(INPUT_DIR) + device_name;
+                if(device_name.find("event") != 0) continue;
+
+                // This signal is sent whenever a file (in this case, device) attributes are modified.
+                // We call the add_input_device function in here and not in IN_CREATE because we
+                // cannot access the device inmediatly after creation, and we have to wait for the proper
+                // IN_ATTRIB signal (it doesn't neccesarily have to be the first one).
+                if(event->mask & IN_ATTRIB) {
+                    add_input_device(d, path);
+                }
+                // This is called when a device is disconnected. Before IN_DELETE is called, IN_ATTRIB is also
+                // called, but we ignore that signal with the conditional found in add_input_device.
+                else if(event->mask & IN_DELETE){
+                    remove_input_device(d, path);
+                }
+            }
+        }
+    }
+}
+
+// Append the slots between the last published head and the new one to the trace, before GD can consume them
+void record_events(Daemon& d, uint32_t from, uint32_t to) {
+    const LinuxInputEvent* slots = shm_slots(d.shm);
+    d.record_buffer.clear();
+    for (uint32_t i = from; i != to; i++) {
+        const LinuxInputEvent& event = slots[i & (d.shm->capacity - 1)];
+        TraceRecord record{};
+        record.time = event.time;
+        record.type = event.type;
+        record.code = event.code;
+        record.value = event.value;
+        record.deviceType = event.deviceType;
+        d.record_buffer.push_back(record);
+    }
+
+    size_t bytes = d.record_buffer.size() * sizeof(TraceRecord);
+    if (write(d.record_fd, d.record_buffer.data(), bytes) != static_cast<ssize_t>(bytes)) {
+        std::cerr << "[CBF] Failed to write trace, recording stopped: " << strerror(errno) << std::endl;
+        close(d.record_fd);
+        d.record_fd = -1;
+    }
+}
+
+// The head index is only published once per wakeup, after every ready device has been drained
+void finish_wakeup(Daemon& d, uint32_t head, uint32_t published_head) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    d.shm->wakeups.store(static_cast<uint32_t>(d.wakeups), std::memory_order_relaxed);
+
+    if (head != published_head) {
+        // one publish time for the whole batch, it becomes visible to GD all at once
+        LinuxInputEvent* slots = shm_slots(d.shm);
+        for (uint32_t i = published_head; i != head; i++) {
+            slots[i & (d.shm->capacity - 1)].published = timespec_to_ns(now);
+        }
+
+        if (d.record_fd != -1) record_events(d, published_head, head);
+        d.shm->head.store(head, std::memory_order_release);
+    }
+
+    // refreshed at least once per watchdog period even when no input arrives
+    if (timespec_to_ns(now) - d.shm->clock_monotonic.load(std::memory_order_relaxed) >= CALIBRATION_INTERVAL_NS) {
+        publish_calibration(d.shm, sample_clocks());
+    }
+}
+
+bool arm_timer(int timer_fd, int64_t when, int64_t interval) {
+    struct itimerspec spec{};
+    spec.it_value.tv_sec = when / 1'000'000'000;
+    spec.it_value.tv_nsec = when % 1'000'000'000;
+    spec.it_interval.tv_sec = interval / 1'000'000'000;
+    spec.it_interval.tv_nsec = interval % 1'000'000'000;
+    return timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == 0;
+}
+
+int64_t replay_due(const Replay& replay, size_t index) {
+    return replay.base + static_cast<int64_t>((replay.records[index].time - replay.origin) / replay.speed);
+}
+
+// Publish every record that's due, then sleep on the timer until the next one is.
+// Events are stamped with the time they were due rather than the time they were written,
+// so a replay looks the same to GD no matter how late the wakeup was.
+void advance_replay(Daemon& d, Replay& replay) {
+    uint64_t expirations;
+    if (read(replay.timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (!replay.started) {
+        // with bind filtering on, wait until GD arms input for a level so every run starts at the same point
+        if (d.shm->filter_active.load(std::memory_order_relaxed) && !d.shm->armed.load(std::memory_order_relaxed)) return;
+        replay.started = true;
+        replay.base = timespec_to_ns(now);
+        std::cerr << "[CBF] Replay started, " << replay.count << " events" << std::endl;
+    }
+
+    uint32_t head = d.shm->head.load(std::memory_order_relaxed);
+    uint32_t tail = d.shm->tail.load(std::memory_order_acquire);
+    uint32_t published_head = head;
+
+    for (; replay.next < replay.count && replay_due(replay, replay.next) <= timespec_to_ns(now); replay.next++) {
+        const TraceRecord& record = replay.records[replay.next];
+        LinuxInputEvent event{};
+        event.time = replay_due(replay, replay.next);
+        event.type = record.type;
+        event.code = record.code;
+        event.value = record.value;
+        event.deviceType = static_cast<DeviceType>(record.deviceType);
+        write_slot(d.shm, event, head, tail);
+    }
+
+    finish_wakeup(d, head, published_head);
+
+    if (replay.next < replay.count) {
+        arm_timer(replay.timer_fd, replay_due(replay, replay.next), 0);
+    } else {
+        arm_timer(replay.timer_fd, 0, 0);
+        std::cerr << "[CBF] Replay finished" << std::endl;
+    }
+}
+
+// Far off CLOCK_REALTIME timer whose only purpose is to be cancelled when the clock is set (NTP step, settimeofday),
+// so the calibration can be refreshed right away instead of GD converting timestamps with the old offset for up to a second
+bool arm_clock_watch(int clock_fd) {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    struct itimerspec spec{};
+    int64_t when = timespec_to_ns(now) + CLOCK_WATCH_NS;
+    spec.it_value.tv_sec = when / 1'000'000'000;
+    spec.it_value.tv_nsec = when % 1'000'000'000;
+    return timerfd_settime(clock_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == 0;
+}
+
+void handle_clock_change(Daemon& d) {
+    uint64_t expirations;
+    if (read(d.clock_fd, &expirations, sizeof(expirations)) == -1 && errno == ECANCELED) {
+        int64_t old_offset = realtime_offset;
+        publish_calibration(d.shm, sample_clocks());
+        std::cerr << "[CBF] Realtime clock was set, offset changed by " << (realtime_offset - old_offset) / 1000 << "us" << std::endl;
+    }
+
+    // cancelled timers stay cancelled until they're armed again
+    if (!arm_clock_watch(d.clock_fd)) std::cerr << "[CBF] Failed to rearm the clock watch: " << strerror(errno) << std::endl;
+}
+
+// Handled after the devices since adding/removing devices invalidates the pointers they were woken up with
+void handle_control_source(Daemon& d, uint64_t source) {
+    switch (source) {
+    case SOURCE_INOTIFY:
+        handle_inotify(d);
+        break;
+    case SOURCE_WATCHDOG: {
+        uint64_t expirations;
+        if (read(d.watchdog_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) break;
+
+        uint32_t current_heartbeat = d.shm->heartbeat.load(std::memory_order_relaxed);
+        if (current_heartbeat != d.last_heartbeat) {
+            d.last_heartbeat = current_heartbeat;
+            d.heartbeat_started = true;
+        } else if (d.heartbeat_started) {
+            std::cerr << "[CBF] GD heartbeat timeout, exiting" << std::endl;
+            d.should_quit = true;
+        }
+        break;
+    }
+    case SOURCE_REPLAY:
+        advance_replay(d, *d.replay);
+        break;
+    case SOURCE_CLOCK:
+        handle_clock_change(d);
+        break;
+    case SOURCE_SIGNAL: {
+        struct signalfd_siginfo info;
+        if (read(d.signal_fd, &info, sizeof(info)) == sizeof(info)) d.should_quit = true;
+        break;
+    }
+    }
+}
+
+void run_epoll(Daemon& d) {
+    epoll_event events[MAX_EVENTS];
+
+    while (!d.should_quit) {
+        int nfds = epoll_wait(d.epoll_fd, events, MAX_EVENTS, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "[CBF] Failed to epoll_wait: " << strerror(errno) << std::endl;
+            break;
+        }
+        d.wakeups++;
+
+        uint32_t head = d.shm->head.load(std::memory_order_relaxed);
+        uint32_t tail = d.shm->tail.load(std::memory_order_acquire);
+        uint32_t published_head = head;
+
+        for (int n = 0; n < nfds; ++n) {
+            if (is_control_source(events[n].data.u64)) continue;
+            InputDevice* device = static_cast<InputDevice*>(events[n].data.ptr);
+            drain_device(*device, d.shm, head, tail);
+        }
+
+        finish_wakeup(d, head, published_head);
+
+        for (int n = 0; n < nfds; ++n) {
+            if (is_control_source(events[n].data.u64)) handle_control_source(d, events[n].data.u64);
+        }
+    }
+}
+
+#ifdef CBF_IO_URING
+void handle_device_completion(Daemon& d, InputDevice& device, bool poll, int32_t res, uint32_t& head, uint32_t& tail) {
+    IoUring& ring = *d.uring;
+    device.uring_pending--;
+    if (device.retired) {
+        if (device.uring_pending == 0) uring_release_device(ring, &device);
+        return;
+    }
+    if (poll) return; // the read linked behind it reports how it went
+
+    bool queued;
+    if (res > 0) {
+        publish_events(device, d.shm, device.read_buffer.data(), res / sizeof(struct input_event), head, tail);
+        queued = uring_queue_read(ring, device, false);
+    } else if (res == -EAGAIN) {
+        queued = uring_queue_read(ring, device, true);
+    } else if (res == -ENODEV || res == -ECANCELED) { // the device is gone, inotify will remove it
+        return;
+    } else {
+        // nothing is reading it anymore, drop it so it comes back through inotify like a replugged device
+        std::cerr << "[CBF] Error reading event from " << device.path << ": " << strerror(-res) << std::endl;
+        remove_input_device(d, device.path); // frees the device, nothing else is in flight for it
+        return;
+    }
+
+    // the reservation flushes the queue first, so this only fails when io_uring_enter itself does,
+    // and then no device can be read anymore, exit so GD falls back to its own input
+    if (!queued) {
+        std::cerr << "[CBF] io_uring can't queue reads anymore, exiting" << std::endl;
+        d.should_quit = true;
+    }
+}
+
+// Every device keeps a read in flight, so a single io_uring_enter both submits the next reads
+// and sleeps until any of them complete. Completions are harvested in one batch per wakeup.
+void run_io_uring(Daemon& d) {
+    IoUring& ring = *d.uring;
+    epoll_event events[MAX_EVENTS];
+
+    if (!uring_queue_control_poll(ring, d.epoll_fd)) {
+        std::cerr << "[CBF] Failed to queue io_uring poll" << std::endl;
+        return;
+    }
+
+    while (!d.should_quit) {
+        if (uring_enter(ring, 1) < 0) {
+            if (errno == EINTR) continue;
+            // EBUSY/EAGAIN mean completions are piling up, reaping them below is the fix
+            if (errno != EBUSY && errno != EAGAIN) {
+                std::cerr << "[CBF] Failed to io_uring_enter: " << strerror(errno) << std::endl;
+                break;
+            }
+        }
+        d.wakeups++;
+
+        uint32_t head = d.shm->head.load(std::memory_order_relaxed);
+        uint32_t tail = d.shm->tail.load(std::memory_order_acquire);
+        uint32_t published_head = head;
+        bool control_ready = false;
+
+        unsigned cq_head = *ring.cq_head;
+        unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; cq_head != cq_tail; cq_head++) {
+            const struct io_uring_cqe& cqe = ring.cqes[cq_head & *ring.cq_mask];
+            if (cqe.user_data == URING_CONTROL) {
+                control_ready = true;
+                continue;
+            }
+            InputDevice* device = reinterpret_cast<InputDevice*>(cqe.user_data & ~URING_POLL_BIT);
+            handle_device_completion(d, *device, cqe.user_data & URING_POLL_BIT, cqe.res, head, tail);
+        }
+        __atomic_store_n(ring.cq_head, cq_head, __ATOMIC_RELEASE);
+
+        finish_wakeup(d, head, published_head);
+
+        if (control_ready) {
+            int nfds = epoll_wait(d.epoll_fd, events, MAX_EVENTS, 0);
+            for (int n = 0; n < nfds; ++n) handle_control_source(d, events[n].data.u64);
+            if (!uring_queue_control_poll(ring, d.epoll_fd)) {
+                std::cerr << "[CBF] Failed to queue io_uring poll" << std::endl;
+                break;
+            }
+        }
+    }
+}
+#else
+void run_io_uring(Daemon&) {}
+#endif
+
+bool add_epoll_source(int epoll_fd, int fd, EpollSource source) {
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = source;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+// The header is mapped first to find out how big the ring GD allocated is
+SharedMemory* map_shared_memory(const std::string& shm_path, size_t& mapped_size) {
     int shm_fd = open(shm_path.c_str(), O_RDWR);
     if (shm_fd == -1) {
         std::cerr << "[CBF] Failed to open shared memory: " << strerror(errno) << std::endl;
-        return 1;
+        return nullptr;
     }
 
-    SharedMemory* shm = static_cast<SharedMemory*>(
-        mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0));
-    close(shm_fd);
+    void* header = mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (header == MAP_FAILED) {
+        std::cerr << "[CBF] Failed to mmap shared memory: " << strerror(errno) << std::endl;
+        close(shm_fd);
+        return nullptr;
+    }
+
+    SharedMemory* shm = static_cast<SharedMemory*>(header);
+    if (!shm_layout_valid(shm)) {
+        std::cerr << "[CBF] Shared memory layout mismatch (magic " << shm->magic << ", version " << shm->version
+            << ", expected version " << SHM_VERSION << ")" << std::endl;
+        shm->error_flag.store(LINUX_INPUT_BAD_LAYOUT);
+        munmap(header, sizeof(SharedMemory));
+        close(shm_fd);
+        return nullptr;
+    }
+
+    mapped_size = shm_size(shm->capacity);
+    munmap(header, sizeof(SharedMemory));
 
-    if (shm == MAP_FAILED) {
+    void* full = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (full == MAP_FAILED) {
         std::cerr << "[CBF] Failed to mmap shared memory: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    return static_cast<SharedMemory*>(full);
+}
+
+int open_record(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "[CBF] Failed to open trace for recording: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    TraceHeader header{};
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.start_time = timespec_to_ns(now);
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        std::cerr << "[CBF] Failed to write trace header: " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Traces are mapped read-only and the records used in place
+const TraceHeader* map_trace(const std::string& path, size_t& mapped_size) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        std::cerr << "[CBF] Failed to open trace: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(TraceHeader))) {
+        std::cerr << "[CBF] Trace is truncated: " << path << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "[CBF] Failed to mmap trace: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    const TraceHeader* header = static_cast<const TraceHeader*>(data);
+    if (!trace_header_valid(header)) {
+        std::cerr << "[CBF] Not a trace, or recorded by an incompatible version: " << path << std::endl;
+        munmap(data, st.st_size);
+        return nullptr;
+    }
+
+    mapped_size = st.st_size;
+    return header;
+}
+
+// <fd>:<type>, e.g. 5:mouse
+bool parse_fake_device(const std::string& spec, FakeDevice& fake) {
+    static const char* type_names[] = { "mouse", "touchpad", "keyboard", "touchscreen", "controller" };
+
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) return false;
+
+    char* end;
+    long fd = strtol(spec.c_str(), &end, 10);
+    if (end != spec.c_str() + colon || fd < 0) return false;
+    fake.fd = static_cast<int>(fd);
+
+    std::string type = spec.substr(colon + 1);
+    for (int i = MOUSE; i < UNKNOWN; i++) {
+        if (type == type_names[i]) {
+            fake.type = static_cast<DeviceType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    if (argc < 2) return false;
+    options.shm_path = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--realtime") {
+            options.realtime = true;
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            options.cpus = argv[++i];
+        } else if (arg == "--io-uring") {
+            options.io_uring = true;
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else if (arg == "--fake-device" && i + 1 < argc) {
+            FakeDevice fake;
+            if (!parse_fake_device(argv[++i], fake)) {
+                std::cerr << "[CBF] Invalid fake device: " << argv[i] << std::endl;
+                return false;
+            }
+            options.fake_devices.push_back(fake);
+        } else if (arg == "--speed" && i + 1 < argc) {
+            options.replay_speed = strtod(argv[++i], nullptr);
+            if (!(options.replay_speed > 0)) {
+                std::cerr << "[CBF] Invalid replay speed: " << argv[i] << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "[CBF] Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_cpu_list(const std::string& list, cpu_set_t& set) {
+    CPU_ZERO(&set);
+    const char* p = list.c_str();
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) return false;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return false;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, &set);
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return CPU_COUNT(&set) > 0;
+}
+
+// Every step is best effort, what actually worked is reported to GD through rt_status
+void enable_realtime(SharedMemory* shm, size_t shm_bytes, const Options& options) {
+    uint32_t status = RT_REQUESTED;
+
+    struct sched_param param{};
+    param.sched_priority = REALTIME_PRIORITY;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == 0) {
+        status |= RT_SCHED_FIFO;
+    } else if (sched_setscheduler(0, SCHED_RR, &param) == 0) {
+        status |= RT_SCHED_RR;
+    } else {
+        std::cerr << "[CBF] Failed to set real-time scheduling: " << strerror(errno) << std::endl;
+        if (setpriority(PRIO_PROCESS, 0, FALLBACK_NICE) == 0) status |= RT_NICE;
+        else std::cerr << "[CBF] Failed to set nice value: " << strerror(errno) << std::endl;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) status |= RT_MLOCK;
+    else std::cerr << "[CBF] Failed to lock memory: " << strerror(errno) << std::endl;
+
+    // make sure the first events written into each page of the ring don't page fault
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(shm, shm_bytes, MADV_POPULATE_WRITE) == 0) status |= RT_PREFAULT;
+#endif
+    if (!(status & RT_PREFAULT)) {
+        const volatile char* bytes = reinterpret_cast<const volatile char*>(shm);
+        long page_size = sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < shm_bytes; offset += page_size) (void) bytes[offset];
+        status |= RT_PREFAULT;
+    }
+
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        if (!parse_cpu_list(options.cpus, set)) {
+            std::cerr << "[CBF] Invalid CPU list: " << options.cpus << std::endl;
+        } else if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+            status |= RT_AFFINITY;
+        } else {
+            std::cerr << "[CBF] Failed to set CPU affinity: " << strerror(errno) << std::endl;
+        }
+    }
+
+    shm->rt_status.store(status, std::memory_order_relaxed);
+    std::cerr << "[CBF] Real-time status: " << status << std::endl;
+}
+
+// Time since the last mark in us, and move the mark up to now
+uint32_t lap_us(std::chrono::steady_clock::time_point& mark) {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - mark);
+    mark = now;
+    return static_cast<uint32_t>(elapsed.count());
+}
+
+int main(int argc, char* argv[]) {
+    auto startup_mark = std::chrono::steady_clock::now();
+
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "[CBF] Usage: linux-input <shm_path> [--realtime] [--cpus <list>] [--io-uring]"
+            << " [--record <trace>] [--replay <trace> [--speed <x>]] [--fake-device <fd>:<type>]..." << std::endl;
         return 1;
     }
 
-    std::vector<struct libevdev*> devices;
-    // To my knowledge, there is not a proper way to access a device's path using libevdev, so we need to store
-    // their paths in a separate vector.
-    std::vector<std::string> devices_paths;
+    const std::string& shm_path = options.shm_path;
+    std::cerr << "[CBF] Linux input program started, shm: " << shm_path << std::endl;
+
+    size_t shm_bytes = 0;
+    SharedMemory* shm = map_shared_memory(shm_path, shm_bytes);
+    if (!shm) return 1;
+
+    std::cerr << "[CBF] Ring capacity: " << shm->capacity << std::endl;
+    shm->startup_us[STARTUP_MAP] = lap_us(startup_mark);
+
+    publish_calibration(shm, sample_clocks());
 
-    const char* input_dir = "/dev/input/";
+    Daemon d;
+    d.shm = shm;
 
-    int epoll_fd = epoll_create1(0);
-    if (epoll_fd == -1) {
+    bool replaying = !options.replay_path.empty();
+    // real devices are left alone when the input comes from a trace or from fake devices
+    bool scanning = !replaying && options.fake_devices.empty();
+    Replay replay;
+    size_t trace_bytes = 0;
+    const TraceHeader* trace = nullptr;
+    if (replaying) {
+        trace = map_trace(options.replay_path, trace_bytes);
+        if (!trace) {
+            munmap(shm, shm_bytes);
+            return 1;
+        }
+        replay.records = reinterpret_cast<const TraceRecord*>(trace + 1);
+        replay.count = (trace_bytes - sizeof(TraceHeader)) / sizeof(TraceRecord);
+        replay.origin = replay.count ? replay.records[0].time : 0;
+        replay.speed = options.replay_speed;
+        d.replay = &replay;
+    }
+
+    if (!options.record_path.empty()) {
+        d.record_fd = open_record(options.record_path);
+        d.record_buffer.reserve(shm->capacity);
+    }
+
+    // has to be decided before any device is opened, since that's when their first read gets queued
+    IoUring ring;
+    if (options.io_uring && !replaying) {
+        if (setup_io_uring(ring)) d.uring = &ring;
+        else std::cerr << "[CBF] Falling back to epoll" << std::endl;
+    }
+
+    d.epoll_fd = epoll_create1(0);
+    if (d.epoll_fd == -1) {
         std::cerr << "[CBF] Failed to create epoll instance: " << strerror(errno) << std::endl;
-        munmap(shm, sizeof(SharedMemory));
+        destroy_io_uring(ring);
+        munmap(shm, shm_bytes);
         return 1;
     }
 
-    int inotify_fd = inotify_init1(IN_NONBLOCK);
-    if (inotify_fd < 0){
+    d.inotify_fd = inotify_init1(IN_NONBLOCK);
+    if (d.inotify_fd < 0){
         std::cerr << "[CBF] Failed to create inotify instance: " << strerror(errno) << std::endl;
-        munmap(shm, sizeof(SharedMemory));
+        destroy_io_uring(ring);
+        munmap(shm, shm_bytes);
         return 1;
     }
 
-    int inotify_watch = inotify_add_watch(inotify_fd, input_dir, IN_DELETE | IN_ATTRIB);
-    if(inotify_watch < 0){
+    int inotify_watch = scanning ? inotify_add_watch(d.inotify_fd, INPUT_DIR, IN_DELETE | IN_ATTRIB) : -1;
+    if(scanning && inotify_watch < 0){
         std::cerr << "[CBF] Failed to create an inotify watch: " << strerror(errno) << std::endl;
-        munmap(shm, sizeof(SharedMemory));
+        destroy_io_uring(ring);
+        munmap(shm, shm_bytes);
         return 1;
     }
-    char inotify_buffer[INOTIFY_BUF_LEN];
 
-    DIR* dir = opendir(input_dir);
+    for (const FakeDevice& fake : options.fake_devices) add_fake_device(d, fake);
+
+    std::vector<std::string> paths;
+    DIR* dir = scanning ? opendir(INPUT_DIR) : nullptr;
     struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
+    while (dir && (entry = readdir(dir)) != nullptr) {
         std::string filename(entry->d_name);
         if (filename.find("event") == 0) {
-            std::string path = std::string(input_dir) + filename;
-            add_input_device(path, epoll_fd, devices, devices_paths);
+            paths.push_back(std::string(INPUT_DIR) + filename);
         }
     }
-    closedir(dir);
+    if (dir) closedir(dir);
 
-    signal(SIGINT, stop);
-    signal(SIGTERM, stop);
+    for (std::unique_ptr<InputDevice>& device : probe_devices(paths)) {
+        if (device) watch_device(d, std::move(device));
+    }
+
+    shm->device_count = static_cast<uint32_t>(d.devices.size());
+    shm->startup_us[STARTUP_PROBE] = lap_us(startup_mark);
 
-    if (devices.empty()) {
+    if (!replaying && d.devices.empty()) {
         std::cerr << "[CBF] No input devices" << std::endl;
-        shm->error_flag = 3;
-        close(epoll_fd);
-        inotify_rm_watch(inotify_fd, inotify_watch);
-        close(inotify_fd);
-        munmap(shm, sizeof(SharedMemory));
+        shm->error_flag.store(LINUX_INPUT_NO_DEVICES);
+        destroy_io_uring(ring);
+        close(d.epoll_fd);
+        inotify_rm_watch(d.inotify_fd, inotify_watch);
+        close(d.inotify_fd);
+        munmap(shm, shm_bytes);
         return 1;
     }
 
-    std::cerr << "[CBF] Waiting for input events" << std::endl;
+    // SIGINT/SIGTERM are delivered through a signalfd so that every reason to wake up goes through epoll
+    sigset_t signal_mask;
+    sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGINT);
+    sigaddset(&signal_mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signal_mask, nullptr);
+    d.signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
 
-    uint32_t last_heartbeat = shm->heartbeat;
-    bool heartbeat_started = false;
-    struct timespec last_heartbeat_time;
-    clock_gettime(CLOCK_MONOTONIC, &last_heartbeat_time);
+    // Watchdog: exit if GD stops updating the heartbeat for a full timer period.
+    d.watchdog_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec watchdog_interval{};
+    watchdog_interval.it_interval.tv_sec = WATCHDOG_TIMEOUT_SECS;
+    watchdog_interval.it_value.tv_sec = WATCHDOG_TIMEOUT_SECS;
 
-    epoll_event events[MAX_EVENTS];
+    d.clock_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
 
-    while (!should_quit.load()) {
-
-        // Watchdog: exit if GD stops updating the heartbeat.
-        // Don't start counting until GD has incremented the heartbeat at least once,
-        // since GD may take a long time to finish loading.
-        uint32_t current_heartbeat = shm->heartbeat;
-        if (current_heartbeat != last_heartbeat) {
-            last_heartbeat = current_heartbeat;
-            clock_gettime(CLOCK_MONOTONIC, &last_heartbeat_time);
-            heartbeat_started = true;
-        } else if (heartbeat_started) {
-            struct timespec now;
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            long elapsed_secs = now.tv_sec - last_heartbeat_time.tv_sec;
-            if (elapsed_secs >= WATCHDOG_TIMEOUT_SECS) {
-                std::cerr << "[CBF] GD heartbeat timeout, exiting" << std::endl;
-                break;
-            }
-        }
+    // Replay pacing: polls for GD arming input until the replay starts, then fires for each due event
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (replaying) replay.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
 
-        int inotify_len = read(inotify_fd, inotify_buffer, INOTIFY_BUF_LEN);
-        if(inotify_len > 0){
-            int i = 0;
-
-            while(i < inotify_len){
-                struct inotify_event *event = ( struct inotify_event * ) &inotify_buffer[ i ];
-
-                if(event->len) {
-                    i+= INOTIFY_EVENT_SIZE + event->len;
-
-                    std::string device_name = std::string(event->name);
-                    std::string path = std::string(input_dir) + device_name;
-                    if(device_name.find("event") != 0) continue;
-
-                    // This signal is sent whenever a file (in this case, device) attributes are modified.
-                    // We call the add_input_device function in here and not in IN_CREATE because we
-                    // cannot access the device inmediatly after creation, and we have to wait for the proper
-                    // IN_ATTRIB signal (it doesn't neccesarily have to be the first one).
-                    if(event->mask & IN_ATTRIB) {
-                        add_input_device(path, epoll_fd, devices, devices_paths);
-                    }
-                    // This is called when a device is disconnected. Before IN_DELETE is called, IN_ATTRIB is also
-                    // called, but we ignore that signal with the conditional found in add_input_device.
-                    else if(event->mask & IN_DELETE){
-                        remove_input_device(path, devices, devices_paths);
-                    }
-                }
-            }
-        }
+    if (d.signal_fd == -1 || d.watchdog_fd == -1 || d.clock_fd == -1
+        || timerfd_settime(d.watchdog_fd, 0, &watchdog_interval, nullptr) == -1
+        || !arm_clock_watch(d.clock_fd)
+        || (scanning && !add_epoll_source(d.epoll_fd, d.inotify_fd, SOURCE_INOTIFY))
+        || !add_epoll_source(d.epoll_fd, d.watchdog_fd, SOURCE_WATCHDOG)
+        || !add_epoll_source(d.epoll_fd, d.signal_fd, SOURCE_SIGNAL)
+        || !add_epoll_source(d.epoll_fd, d.clock_fd, SOURCE_CLOCK)
+        || (replaying && (replay.timer_fd == -1
+            || !arm_timer(replay.timer_fd, timespec_to_ns(now) + REPLAY_ARM_POLL_NS, REPLAY_ARM_POLL_NS)
+            || !add_epoll_source(d.epoll_fd, replay.timer_fd, SOURCE_REPLAY))))
+    {
+        std::cerr << "[CBF] Failed to set up event sources: " << strerror(errno) << std::endl;
+        shm->error_flag.store(LINUX_INPUT_NO_DEVICES);
+        if (d.signal_fd != -1) close(d.signal_fd);
+        if (d.watchdog_fd != -1) close(d.watchdog_fd);
+        if (d.clock_fd != -1) close(d.clock_fd);
+        if (replay.timer_fd != -1) close(replay.timer_fd);
+        if (trace) munmap(const_cast<TraceHeader*>(trace), trace_bytes);
+        if (d.record_fd != -1) close(d.record_fd);
+        destroy_io_uring(ring);
+        d.devices.clear();
+        close(d.epoll_fd);
+        inotify_rm_watch(d.inotify_fd, inotify_watch);
+        close(d.inotify_fd);
+        munmap(shm, shm_bytes);
+        return 1;
+    }
 
-        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, 100);
-        if (nfds == -1) {
-            if (errno == EINTR) continue;
-            std::cerr << "[CBF] Failed to epoll_wait: " << strerror(errno) << std::endl;
-            break;
-        }
+    if (options.realtime) enable_realtime(shm, shm_bytes, options);
 
-        for (int n = 0; n < nfds; ++n) {
-            struct libevdev* dev = static_cast<struct libevdev*>(events[n].data.ptr);
-            struct input_event ev;
+    shm->startup_us[STARTUP_SETUP] = lap_us(startup_mark);
+    shm->state.store(LINUX_INPUT_READY, std::memory_order_release);
+    std::cerr << "[CBF] Ready, " << d.devices.size() << " devices (map " << shm->startup_us[STARTUP_MAP]
+        << "us, probe " << shm->startup_us[STARTUP_PROBE] << "us, setup " << shm->startup_us[STARTUP_SETUP] << "us)" << std::endl;
 
-            while (libevdev_has_event_pending(dev)) {
-                int rc = libevdev_next_event(dev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
-                if (rc != -EAGAIN && rc != 0) {
-                    if (rc == -ENODEV) break;
+    if (replaying) std::cerr << "[CBF] Replaying " << options.replay_path << " at " << replay.speed << "x" << std::endl;
+    else std::cerr << "[CBF] Waiting for input events (" << (d.uring ? "io_uring" : "epoll") << ")" << std::endl;
 
-                    std::cerr << "[CBF] Error reading event: " << strerror(-rc) << std::endl;
-                    break;
-                }
+    d.last_heartbeat = shm->heartbeat.load(std::memory_order_relaxed);
+    auto start_time = std::chrono::steady_clock::now();
 
-                int64_t time = convert_time(ev.time);
-                uint16_t code = ev.code;
-                int32_t value = ev.value;
-                DeviceType device_type;
+    if (d.uring) run_io_uring(d);
+    else run_epoll(d);
 
-                if (ev.type != EV_ABS && (ev.type != EV_KEY || ev.value == 2)) {
-                    continue;
-                }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cerr << "[CBF] " << d.wakeups << " wakeups in " << elapsed << "s ("
+        << (elapsed > 0 ? d.wakeups / elapsed : 0) << "/s)" << std::endl;
 
-                if (ev.code == BTN_LEFT || ev.code == BTN_RIGHT) {
-                    device_type = MOUSE;
-                }
-                else if (libevdev_has_event_code(dev, EV_KEY, KEY_1)) {
-                    device_type = KEYBOARD;
-                    code = convert_scan_code(ev.code);
-                }
-                else if (libevdev_has_property(dev, INPUT_PROP_DIRECT)) {
-                    device_type = TOUCHSCREEN;
-                }
-                else if (libevdev_has_property(dev, INPUT_PROP_BUTTONPAD)) {
-                    device_type = TOUCHPAD;
-                }
-                else if (libevdev_has_event_code(dev, EV_KEY, BTN_GAMEPAD)) {
-                    device_type = CONTROLLER;
-                    if (ev.type == EV_ABS) {
-                        if (ev.code == ABS_Z || ev.code == ABS_RZ) value = normalize_axis(dev, code, value, 0, 255);
-                        else value = normalize_axis(dev, code, value, -32768, 32767);
-                    }
-                }
-                else {
-                    device_type = UNKNOWN;
-                }
+    // GD goes back to its own input handling
+    shm->state.store(LINUX_INPUT_STOPPED, std::memory_order_release);
 
-                uint32_t h = shm->head;
-                uint32_t t = shm->tail;
-                if (h - t >= RING_BUFFER_SIZE) continue; // buffer full, drop event
-
-                LinuxInputEvent& slot = shm->events[h & (RING_BUFFER_SIZE - 1)];
-                slot.time = time;
-                slot.type = ev.type;
-                slot.code = code;
-                slot.value = value;
-                slot.deviceType = device_type;
-                std::atomic_thread_fence(std::memory_order_release);
-                shm->head = h + 1;
-            }
+    // the ring goes first so nothing is still reading into a device's buffer when it's freed
+    destroy_io_uring(ring);
+    if (!d.uring) {
+        for (auto& entry : d.devices) {
+            epoll_ctl(d.epoll_fd, EPOLL_CTL_DEL, entry.second->fd, nullptr);
         }
     }
+    d.devices.clear();
 
-    for (auto dev : devices) {
-        int fd = libevdev_get_fd(dev);
-        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
-        libevdev_free(dev);
-        close(fd);
+    if (replaying) {
+        close(replay.timer_fd);
+        munmap(const_cast<TraceHeader*>(trace), trace_bytes);
     }
+    if (d.record_fd != -1) close(d.record_fd);
 
-    close(epoll_fd);
-    inotify_rm_watch(inotify_fd, inotify_watch);
-    close(inotify_fd);
-    munmap(shm, sizeof(SharedMemory));
+    close(d.signal_fd);
+    close(d.watchdog_fd);
+    close(d.clock_fd);
+    close(d.epoll_fd);
+    inotify_rm_watch(d.inotify_fd, inotify_watch);
+    close(d.inotify_fd);
+    munmap(shm, shm_bytes);
     unlink(shm_path.c_str());
 
     std::cerr << "[CBF] Linux input program exiting" << std::endl;
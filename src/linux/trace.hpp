@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../linuxshm.hpp"
+
+/*
+binary trace of the events linux-input published to GD (--record), and can feed back in (--replay)
+a header followed by fixed size records, so a trace can be mmapped and indexed directly
+records don't depend on the shared memory layout, old traces stay usable when SHM_VERSION changes
+*/
+
+constexpr uint32_t TRACE_MAGIC = 0x54464243; // "CBFT"
+constexpr uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+    int64_t start_time; // CLOCK_MONOTONIC ns when recording started
+    int64_t reserved2;
+};
+
+struct TraceRecord {
+    int64_t time; // CLOCK_MONOTONIC ns
+    uint16_t type;
+    uint16_t code;
+    int32_t value;
+    int8_t deviceType;
+    uint8_t padding[7];
+};
+
+static_assert(sizeof(TraceHeader) == 32, "TraceHeader must stay 32 bytes");
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+inline bool trace_header_valid(const TraceHeader* header) {
+    return header->magic == TRACE_MAGIC
+        && header->version == TRACE_VERSION
+        && header->record_size == sizeof(TraceRecord);
+}
@@ -31,3 +31,5 @@ constexpr int BTN_THUMBL = 0x13d;
 constexpr int BTN_THUMBR = 0x13e;
 constexpr int BTN_TOUCH = 0x14a;
 
+constexpr int KEY_MAX = 0x2ff;
+
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+layout of the shared memory ring between GD (consumer) and linux-input (producer)
+both sides are compiled separately, so bump SHM_VERSION whenever anything in here changes
+*/
+
+constexpr uint32_t SHM_MAGIC = 0x31464243; // "CBF1"
+constexpr uint32_t SHM_VERSION = 7;
+constexpr size_t SHM_CACHE_LINE = 64;
+
+// with no input, linux-input only wakes up this often, to check that GD's heartbeat is still moving
+constexpr int SHM_WATCHDOG_SECS = 5;
+
+constexpr uint32_t SHM_DEFAULT_CAPACITY = 256;
+constexpr uint32_t SHM_MIN_CAPACITY = 64;
+constexpr uint32_t SHM_MAX_CAPACITY = 65536;
+
+// evdev codes go up to KEY_MAX (0x2ff), extended scancodes (0xE0xx) are packed in after them
+constexpr uint32_t SHM_CODE_COUNT = 0x400;
+
+enum LinuxInputError : uint32_t {
+    LINUX_INPUT_OK = 0,
+    LINUX_INPUT_NO_DEVICES = 3,
+    LINUX_INPUT_BAD_LAYOUT = 4
+};
+
+enum LinuxInputState : uint32_t {
+    LINUX_INPUT_STARTING = 0, // GD zeroes the shared memory before launching linux-input
+    LINUX_INPUT_READY = 1, // devices are open and events are being published
+    LINUX_INPUT_STOPPED = 2
+};
+
+enum StartupPhase : uint32_t {
+    STARTUP_MAP, // process start -> shared memory mapped
+    STARTUP_PROBE, // opening and querying every input device
+    STARTUP_SETUP, // event sources, real-time mode
+    STARTUP_PHASE_COUNT
+};
+
+// which parts of linux-input's real-time mode took effect
+enum RealtimeStatus : uint32_t {
+    RT_REQUESTED = 1 << 0,
+    RT_SCHED_FIFO = 1 << 1,
+    RT_SCHED_RR = 1 << 2,
+    RT_NICE = 1 << 3,
+    RT_MLOCK = 1 << 4,
+    RT_PREFAULT = 1 << 5,
+    RT_AFFINITY = 1 << 6
+};
+
+enum DeviceType : int8_t {
+    MOUSE,
+    TOUCHPAD,
+    KEYBOARD,
+    TOUCHSCREEN,
+    CONTROLLER,
+    UNKNOWN
+};
+
+// two slots per cache line, so a slot never straddles one
+struct alignas(32) LinuxInputEvent {
+    int64_t time; // CLOCK_MONOTONIC, ns
+    uint16_t type;
+    uint16_t code;
+    int32_t value;
+    DeviceType deviceType;
+    int64_t published; // CLOCK_MONOTONIC ns when linux-input made the event visible to GD
+};
+
+static_assert(sizeof(LinuxInputEvent) == 32, "LinuxInputEvent must stay 32 bytes");
+
+struct SharedMemory {
+    // written by GD before launching linux-input, read-only afterwards
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity; // number of slots, power of 2
+    uint32_t slot_size;
+
+    std::atomic<uint32_t> error_flag;
+    std::atomic<uint32_t> rt_status; // RealtimeStatus bits
+
+    // (monotonic, realtime) pair for converting event timestamps, guarded by a seqlock (odd = being written)
+    std::atomic<uint32_t> clock_seq;
+    std::atomic<int64_t> clock_monotonic; // ns
+    std::atomic<int64_t> clock_realtime; // FILETIME
+
+    // LinuxInputState, stored with release once the fields below are filled in
+    std::atomic<uint32_t> state;
+    uint32_t device_count; // devices opened during startup
+    uint32_t startup_us[STARTUP_PHASE_COUNT];
+
+    // written by linux-input
+    alignas(SHM_CACHE_LINE) std::atomic<uint32_t> head;
+    std::atomic<uint32_t> dropped; // events lost because the ring was full
+    std::atomic<uint32_t> wakeups; // times linux-input has woken up, for checking it stays asleep while idle
+
+    // written by GD
+    alignas(SHM_CACHE_LINE) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> heartbeat;
+
+    // written by GD so linux-input only forwards events that can affect gameplay
+    alignas(SHM_CACHE_LINE) std::atomic<uint32_t> filter_active; // 0 -> forward everything
+    std::atomic<uint32_t> armed; // 1 while a level is being played
+    std::atomic<int32_t> left_stick_deadzone;
+    std::atomic<int32_t> right_stick_deadzone;
+    std::atomic<int32_t> hat_deadzone;
+    std::atomic<int32_t> trigger_threshold;
+    std::atomic<uint32_t> bound_codes[SHM_CODE_COUNT / 32]; // bitmap indexed by shm_code_index()
+
+    // `capacity` slots follow the header, starting on their own cache line
+};
+
+static_assert(sizeof(SharedMemory) % SHM_CACHE_LINE == 0, "ring slots must start on a cache line");
+
+inline size_t shm_size(uint32_t capacity) {
+    return sizeof(SharedMemory) + static_cast<size_t>(capacity) * sizeof(LinuxInputEvent);
+}
+
+inline LinuxInputEvent* shm_slots(SharedMemory* shm) {
+    return reinterpret_cast<LinuxInputEvent*>(shm + 1);
+}
+
+inline uint32_t shm_code_index(uint16_t code) {
+    return (code & 0xFF00) == 0xE000 ? 0x300 + (code & 0xFF) : code;
+}
+
+inline bool shm_code_bound(const SharedMemory* shm, uint16_t code) {
+    uint32_t index = shm_code_index(code);
+    if (index >= SHM_CODE_COUNT) return false;
+    return (shm->bound_codes[index / 32].load(std::memory_order_relaxed) >> (index % 32)) & 1;
+}
+
+inline bool shm_layout_valid(const SharedMemory* shm) {
+    return shm->magic == SHM_MAGIC
+        && shm->version == SHM_VERSION
+        && shm->slot_size == sizeof(LinuxInputEvent)
+        && shm->capacity >= SHM_MIN_CAPACITY
+        && shm->capacity <= SHM_MAX_CAPACITY
+        && (shm->capacity & (shm->capacity - 1)) == 0;
+}
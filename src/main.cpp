@@ -9,52 +9,69 @@
 #include <Geode/modify/PlayerObject.hpp>
 #include <Geode/modify/EndLevelLayer.hpp>
 #include <Geode/modify/GJGameLevel.hpp>
+#include <Geode/modify/PauseLayer.hpp>
 #include <tulip/TulipHook.hpp>
 
-constexpr double SMALLEST_FLOAT = std::numeric_limits<float>::min();
+static_assert(InputJump == static_cast<uint8_t>(PlayerButton::Jump)
+	&& InputLeft == static_cast<uint8_t>(PlayerButton::Left)
+	&& InputRight == static_cast<uint8_t>(PlayerButton::Right));
 
-constexpr PlayerButtonCommand EMPTY_INPUT = PlayerButtonCommand {
-	.m_button = PlayerButton::Jump,
-	.m_isPush = false,
-	.m_isPlayer2 = false,
-	.m_timestamp = 0
-};
-constexpr Step EMPTY_STEP = Step {
-	.input = EMPTY_INPUT,
-	.deltaFactor = 1.0,
-	.endStep = true,
+RingQueue<StepInput> inputVector;
+StepQueue stepQueue;
+uint64_t savedSubsteps = 0; // since the level was entered
+FlightRecorder flightRecorder;
+InputLatency inputLatency;
+
+/*
+the level objects the step hooks need, resolved once per frame in onFrameStart instead of calling PlayLayer::get() on every step
+pl is null outside of levels
+*/
+struct FrameContext {
+	PlayLayer* pl = nullptr;
+	PlayerObject* p1 = nullptr;
+	PlayerObject* p2 = nullptr;
 };
 
-std::vector<struct PlayerButtonCommand> inputVector;
-std::deque<struct Step> stepQueue;
+FrameContext frame;
+
+void resolveFrame(PlayLayer* pl) {
+	frame.pl = pl;
+	frame.p1 = pl ? pl->m_player1 : nullptr;
+	frame.p2 = pl ? pl->m_player2 : nullptr;
+}
 
 bool softToggle;
 bool enableRightClick;
 
-PlayerButtonCommand nextInput = EMPTY_INPUT;
-
 TimestampType lastFrameTime;
 TimestampType currentFrameTime;
 
 bool firstFrame = true; // necessary to prevent accidental inputs at the start of the level or when unpausing
 bool skipUpdate = true; // true -> dont split steps during PlayerObject::update()
 bool linuxNative = false;
+bool linuxReady = false; // linux-input is publishing events, so GD's own queued inputs are ignored
 
 std::array<std::unordered_set<size_t>, 6> inputBinds;
-std::unordered_set<uint16_t> heldInputs;
 
 /*
 this function copies over the input data and uses it to build a queue of physics steps
 based on when each input happened relative to the start of the frame
-(and also calculates the associated stepDelta multipliers for each step)
 */
 void buildStepQueue(int stepCount) {
-	PlayLayer* playLayer = PlayLayer::get();
-	nextInput = EMPTY_INPUT;
-	stepQueue = {}; // shouldnt be necessary, but just in case
+	PlayLayer* playLayer = frame.pl;
+	stepQueue.clear(); // shouldnt be necessary, but just in case
+
+	FrameRecord& record = flightRecorder.next(currentFrameTime);
+	record.deltaTime = firstFrame ? 0.0f : static_cast<float>(timestampToSeconds(currentFrameTime - lastFrameTime));
+	record.stepCount = stepCount;
+	record.branch = static_cast<uint8_t>(lastPacingBranch);
+	record.backlog = static_cast<int32_t>(stepBudget.backlog() * 1e6);
 
 	#ifdef GEODE_IS_WINDOWS
-	if (linuxNative) linuxCheckInputs();
+	if (linuxReady) {
+		ScopedCycles timer(record.linuxInputCycles);
+		linuxCheckInputs();
+	}
 	#endif
 	
 	// workaround for a bug in geode 5.3.0 that affects android
@@ -75,55 +92,76 @@ void buildStepQueue(int stepCount) {
 		return;
 	}
 
-	if (!linuxNative) inputVector.insert(inputVector.end(), playLayer->m_queuedButtons.begin(), playLayer->m_queuedButtons.end());
-	playLayer->m_queuedButtons.clear();
-
-	TimestampType deltaTime = currentFrameTime - lastFrameTime;
-	TimestampType stepDelta = deltaTime / stepCount;
-
-	int inputIdx = 0;
-	for (int i = 0; i < stepCount; i++) { // for each physics step of the frame
-		double elapsedTime = 0.0;
-		while (inputIdx < inputVector.size()) { // while loop to account for multiple inputs on the same step
-			PlayerButtonCommand input = inputVector[inputIdx];
-			GEODE_ANDROID(input.m_timestamp /= androidFactor;)
-
-			if (input.m_timestamp - lastFrameTime < stepDelta * (i + 1)) { // if the next input in the vector happened on the current step, or if its the last step
-				double inputTime = fmod((input.m_timestamp - lastFrameTime), stepDelta) / stepDelta; // proportion of step elapsed at the time the input was made
-				stepQueue.emplace_back(Step{ input, std::clamp(inputTime - elapsedTime, SMALLEST_FLOAT, 1.0), false });
-				elapsedTime = inputTime;
-				inputIdx++;
-				//log::info("i{} l{} c{} {}", input.m_timestamp, lastFrameTime, currentFrameTime, input.m_timestamp < lastFrameTime || input.m_timestamp > currentFrameTime);
-			}
-			else break; 
+	if (!linuxReady) {
+		for (const PlayerButtonCommand& input : playLayer->m_queuedButtons) {
+			double seconds = input.m_timestamp;
+			GEODE_ANDROID(seconds /= androidFactor;)
+			// GD's timestamps aren't on the clock used with linux-input, so these land at the start of the frame
+			TimestampType timestamp = linuxNative ? lastFrameTime : timestampFromSeconds(seconds);
+			inputVector.emplace_back(StepInput{ timestamp, static_cast<uint8_t>(input.m_button), input.m_isPush, input.m_isPlayer2 });
 		}
-
-		stepQueue.emplace_back(Step{ EMPTY_INPUT, std::max(SMALLEST_FLOAT, 1.0 - elapsedTime), true });
 	}
+	playLayer->m_queuedButtons.clear();
+
+	size_t used = stepQueue.build(inputVector, lastFrameTime, currentFrameTime, stepCount);
+	record.inputs = static_cast<uint32_t>(used);
+	record.substeps = static_cast<uint32_t>(stepQueue.size());
+	record.savedSubsteps = static_cast<uint8_t>(std::min<uint32_t>(stepQueue.saved(), UINT8_MAX));
+	savedSubsteps += stepQueue.saved();
+	for (size_t i = used; i < inputVector.size(); i++) inputLatency.deferred(inputVector[i].source);
 
 	lastFrameTime = currentFrameTime;
-	inputVector.erase(inputVector.begin(), inputVector.begin() + inputIdx); // keep inputs with timestamps later than currentFrameTime
+	inputVector.pop_front(used); // keep inputs with timestamps later than currentFrameTime
 }
 
 /*
-return the first step in the queue,
-also check if an input happened on the previous step, if so run handleButton.
+return the next substep,
+also check if an input happened on the previous substep, if so run handleButton.
 */
 Step popStepQueue() {
-	if (stepQueue.empty()) return EMPTY_STEP;
-
-	Step front = stepQueue.front();
-	double deltaFactor = front.deltaFactor;
+	Step input;
+	Step step = stepQueue.pop(input);
 
-	if (nextInput.m_timestamp != 0) {
-		PlayLayer* playLayer = PlayLayer::get();
-		playLayer->handleButton(nextInput.m_isPush, (int)nextInput.m_button, !nextInput.m_isPlayer2);
+	if (!input.endStep) {
+		frame.pl->handleButton(input.isPush, input.button, !input.isPlayer2);
+		inputLatency.record(stepQueue.firedTrace(), getCurrentTimestamp());
 	}
 
-	nextInput = front.input;
-	stepQueue.pop_front();
+	return step;
+}
+
+bool lateInput = false;
+uint64_t lateInputs = 0; // since the level was entered
 
-	return front;
+/*
+between physics steps, pick up inputs that linux-input published after the frame started
+they go on the steps that haven't run yet instead of waiting for the next frame
+GD's m_queuedButtons only fills up while events are dispatched, which never happens in the middle of the physics steps
+*/
+void pollLateInputs() {
+#ifdef GEODE_IS_WINDOWS
+	if (!lateInput || !linuxReady || skipUpdate) return;
+	if (!linuxInputPending()) return; // most steps, a single load of the ring head
+
+	FrameRecord& record = flightRecorder.current();
+	ScopedCycles timer(record.linuxInputCycles);
+
+	size_t from = inputVector.size();
+	linuxCheckInputs();
+	if (inputVector.size() == from) return;
+
+	// inputs read at the start of the frame but deferred to the next one go in as well,
+	// otherwise a late release could land on this frame while its press waits for the next
+	uint32_t saved = stepQueue.saved();
+	size_t used = stepQueue.splice(inputVector, 0);
+	inputVector.pop_front(used);
+	record.inputs += static_cast<uint32_t>(used);
+	lateInputs += used;
+
+	// the schedule was rebuilt, so was its count of coalesced substeps
+	record.savedSubsteps = static_cast<uint8_t>(std::min<uint32_t>(stepQueue.saved(), UINT8_MAX));
+	savedSubsteps += static_cast<int64_t>(stepQueue.saved()) - saved;
+#endif
 }
 
 #ifdef GEODE_IS_WINDOWS
@@ -146,6 +184,7 @@ void updateKeybinds() {
 		inputBinds[p2Jump] = { KEY_Up, CONTROLLER_LB };
 		inputBinds[p2Left] = { KEY_Left, CONTROLLER_RTHUMBSTICK_LEFT };
 		inputBinds[p2Right] = { KEY_Right, CONTROLLER_RTHUMBSTICK_RIGHT };
+		linuxCompileBinds();
 		return;
 	}
 
@@ -170,6 +209,7 @@ void updateKeybinds() {
 	for (int i = 0; i < v.size(); i++) binds[p2Right].emplace(v[i].key);
 
 	inputBinds = binds;
+	linuxCompileBinds();
 }
 #endif
 
@@ -187,40 +227,122 @@ void decomp_resetCollisionLog(PlayerObject* p) {
 	p->m_lastCollisionTop = -1;
 }
 
-double averageDelta = 0.0;
-
-bool physicsBypass;
-bool legacyBypass;
-
 /*
-determine the number of physics steps that happen on each frame,
-need to rewrite the vanilla formula bc otherwise you'd have to use inline assembly to get the step count
+the extra collision checks done after an input mid-step, timed for the flight recorder
 */
-int calculateStepCount(double delta, float timewarp, bool forceVanilla) {
-	if (!physicsBypass || forceVanilla) { // vanilla 2.2
-		return std::round(std::max(1.0, ((delta * 60.0) / std::min(1.0f, timewarp)) * 4.0)); // not sure if this is different from `(delta * 240) / timewarp` bc of float precision
-	}
-	else if (legacyBypass) { // 2.1 physics bypass (same as vanilla 2.1)
-		return std::round(std::max(4.0, delta * 240.0) / std::min(1.0f, timewarp));
+void checkSplitCollisions(PlayLayer* pl, PlayerObject* player, float dt) {
+	FrameRecord& record = flightRecorder.current();
+	ScopedCycles timer(record.collisionCycles);
+	record.collisionChecks++;
+	pl->checkCollisions(player, dt, true);
+}
+
+bool dumpOnDeath = false; // also on level exit
+bool dumpOnPause = false;
+
+void dumpFlightRecorder(DumpReason reason) {
+	if (!flightRecorder.recording()) return;
+
+	static constexpr const char* names[] = { "pause", "death", "exit" };
+	std::filesystem::path path = Mod::get()->getSaveDir() / "flight-recorder" / (std::string(names[static_cast<int>(reason)]) + ".cbfr");
+	if (flightRecorder.dump(path, reason, timestampFrequency())) log::info("Flight recorder dumped to {}", path.string());
+	else log::warn("Failed to write flight recorder dump to {}", path.string());
+}
+
+bool physicsBypass;
+BypassMode bypassMode = BypassMode::Predicted;
+std::unique_ptr<PacingPredictor> pacingPredictor = std::make_unique<EmaPredictor>();
+PacingStats pacingStats;
+PacingBranch lastPacingBranch = PacingBranch::Vanilla;
+StepBudget stepBudget;
+int budgetedSteps = 0; // steps the budget allowed this frame, 0 -> not measuring
+TimestampType budgetedTime = 0; // time spent in this frame's physics steps so far
+
+void setBypassMode(const std::string& mode) {
+	if (mode == "2.1") bypassMode = BypassMode::Legacy;
+	else {
+		bypassMode = BypassMode::Predicted;
+		if (mode == "2.2 percentile") pacingPredictor = std::make_unique<PercentilePredictor>();
+		else if (mode == "2.2 hysteresis") pacingPredictor = std::make_unique<HysteresisPredictor>();
+		else pacingPredictor = std::make_unique<EmaPredictor>();
 	}
-	else { // sorta just 2.2 + physics bypass but it doesnt allow below 240 steps/sec, also it smooths things out a bit when lagging
-		double animationInterval = CCDirector::sharedDirector()->getAnimationInterval();
-		averageDelta = (0.05 * delta) + (0.95 * averageDelta); // exponential moving average to detect lag/external fps caps
-		if (averageDelta > animationInterval * 10) averageDelta = animationInterval * 10; // dont let averageDelta get too high
+	pacingStats.reset();
+}
 
-		bool laggingOneFrame = animationInterval < delta - (1.0 / 240.0); // more than 1 step of lag on a single frame
-		bool laggingManyFrames = averageDelta - animationInterval > 0.0005; // average lag is >0.5ms
+void logPacingStats() {
+	if (pacingStats.frames() == 0) return;
+	log::info(
+		"Physics bypass pacing ({}): {} frames, {:.2f} steps/frame, variance {:.3f}, changed on {} frames, caught up on {} frames",
+		pacingPredictor->name(),
+		pacingStats.frames(),
+		pacingStats.mean(),
+		pacingStats.variance(),
+		pacingStats.changes(),
+		pacingStats.catchUps()
+	);
+	pacingStats.reset();
+}
 
-		if (!laggingOneFrame && !laggingManyFrames) { // no stepcount variance when not lagging
-			return std::round(std::ceil((animationInterval * 240.0) - 0.0001) / std::min(1.0f, timewarp));
-		}
-		else if (!laggingOneFrame) { // consistently low fps
-			return std::round(std::ceil(averageDelta * 240.0) / std::min(1.0f, timewarp));
-		}
-		else { // need to catch up badly
-			return std::round(std::ceil(delta * 240.0) / std::min(1.0f, timewarp));
-		}
+void logInputLatency() {
+	static constexpr const char* names[] = { "GD", "Linux" };
+	for (int i = 0; i < SOURCE_COUNT; i++) {
+		const InputLatency::Source& source = inputLatency.source(static_cast<InputSource>(i));
+		if (source.toHandled.count() == 0 && source.deferred == 0) continue;
+
+		log::info(
+			"{} input latency over {} inputs: to frame p50 {:.3f}ms p99 {:.3f}ms, to handleButton p50 {:.3f}ms p99 {:.3f}ms max {:.3f}ms",
+			names[i],
+			source.toHandled.count(),
+			source.toFrame.percentile(50) / 1e6,
+			source.toFrame.percentile(99) / 1e6,
+			source.toHandled.percentile(50) / 1e6,
+			source.toHandled.percentile(99) / 1e6,
+			source.toHandled.max() / 1e6
+		);
+		log::info(
+			"{} inputs outside their frame: {} moved later to fit (p50 {:.3f}ms max {:.3f}ms), {} deferred to the next frame",
+			names[i],
+			source.clamped.count(),
+			source.clamped.percentile(50) / 1e6,
+			source.clamped.max() / 1e6,
+			source.deferred
+		);
 	}
+	inputLatency.reset();
+}
+
+void logLateInputs() {
+	if (lateInputs == 0) return;
+	log::info("Added {} inputs to steps of the frame they arrived during", lateInputs);
+	lateInputs = 0;
+}
+
+void logSavedSubsteps() {
+	if (savedSubsteps == 0) return;
+	log::info("Coalesced {} substeps", savedSubsteps);
+	savedSubsteps = 0;
+}
+
+void logStepBudget() {
+	if (!stepBudget.active() || stepBudget.frames() == 0) return;
+	log::info(
+		"Step budget: {:.1f}us/step, capped {} of {} frames, backlog {:.1f}ms (max {:.1f}ms), dropped {:.1f}ms",
+		stepBudget.costPerStep() * 1e6,
+		stepBudget.budgetHits(),
+		stepBudget.frames(),
+		stepBudget.backlog() * 1e3,
+		stepBudget.maxBacklog() * 1e3,
+		stepBudget.droppedTime() * 1e3
+	);
+	stepBudget.resetCounters();
+}
+
+/*
+determine the number of physics steps that happen on each frame
+*/
+int calculateStepCount(double delta, float timewarp, bool forceVanilla) {
+	BypassMode mode = !physicsBypass || forceVanilla ? BypassMode::Off : bypassMode;
+	return computeStepCount(delta, timewarp, mode, CCDirector::sharedDirector()->getAnimationInterval(), *pacingPredictor, &pacingStats, &lastPacingBranch);
 }
 
 bool safeMode;
@@ -228,9 +350,13 @@ bool safeMode;
 class $modify(PlayLayer) {
 	bool init(GJGameLevel* level, bool useReplay, bool dontCreateObjects) {
 		#ifdef GEODE_IS_WINDOWS
-		if (linuxNative) updateKeybinds(); // update keybinds when you enter a level (for linux)
+		if (linuxNative) { // update keybinds when you enter a level (for linux)
+			updateKeybinds();
+			linuxPublishBinds();
+		}
 		#endif
 		bool result = PlayLayer::init(level, useReplay, dontCreateObjects);
+		if (result) resolveFrame(this); // the players can be updated before the next frame starts
 		if (!softToggle) {
 			this->m_clickBetweenSteps = false;
 			this->m_clickOnSteps = false;
@@ -252,6 +378,25 @@ class $modify(PlayLayer) {
 	void showNewBest(bool p0, int p1, int p2, bool p3, bool p4, bool p5) {
 		if (!safeMode || softToggle) PlayLayer::showNewBest(p0, p1, p2, p3, p4, p5);
 	}
+
+	void destroyPlayer(PlayerObject* player, GameObject* object) {
+		bool wasDead = this->m_playerDied;
+		PlayLayer::destroyPlayer(player, object);
+		if (!wasDead && this->m_playerDied && dumpOnDeath) dumpFlightRecorder(DumpReason::Death);
+	}
+
+	void onQuit() {
+		if (dumpOnDeath) dumpFlightRecorder(DumpReason::Exit);
+		logPacingStats();
+		logStepBudget();
+		logInputLatency();
+		logSavedSubsteps();
+		logLateInputs();
+		#ifdef GEODE_IS_WINDOWS
+		if (linuxNative) linuxLogLatency();
+		#endif
+		PlayLayer::onQuit();
+	}
 };
 
 bool mouseFix;
@@ -261,24 +406,31 @@ void onFrameStart() {
 	PlayLayer* playLayer = PlayLayer::get();
 	CCNode* par;
 
+	resolveFrame(playLayer);
+
 	if (!precisionFix || linuxNative) currentFrameTime = getCurrentTimestamp();
 
-	if (softToggle // CBF disabled
+	bool inactive = softToggle // CBF disabled
 	#ifdef GEODE_IS_WINDOWS
 		|| !GetFocus() // GD is minimized
 	#endif
 		|| !playLayer // not in level
 		|| !(par = playLayer->getParent()) // must be a real playLayer with a parent (for compatibility with mods that use a fake playLayer)
 		|| (par->getChildByType<PauseLayer>(0)) // if paused
-		|| (playLayer->getChildByType<EndLevelLayer>(0))) // if on endscreen
-	{
+		|| (playLayer->getChildByType<EndLevelLayer>(0)); // if on endscreen
+
+	if (inactive) {
 		firstFrame = true;
 		skipUpdate = true;
 		inputVector.clear();
 	}
 	
 	#ifdef GEODE_IS_WINDOWS
-	if (linuxNative) linuxHeartbeat();
+	if (linuxNative) {
+		linuxHeartbeat();
+		linuxSetArmed(!inactive);
+		linuxReady = linuxInputReady();
+	}
 	if (mouseFix && !skipUpdate) { // reduce lag with high polling rate mice by limiting the number of mouse movements per frame to 1
 		MSG msg;
 		int index = 1;
@@ -310,7 +462,7 @@ class $modify(CCScheduler) {
 		#else
 		if (precisionFix && !linuxNative) {
 			static LARGE_INTEGER* cur = reinterpret_cast<LARGE_INTEGER*>(geode::base::getCocos() + 0x1a84d8);
-			currentFrameTime = (double)cur->QuadPart / (double)freq.QuadPart;
+			currentFrameTime = cur->QuadPart;
 		}
 		#endif
 		
@@ -321,59 +473,98 @@ class $modify(CCScheduler) {
 int stepCount;
 bool clickOnSteps = false;
 
-class $modify(GJBaseGameLayer) {
+/*
+the hooks below are specialized on the settings that only change from the settings menu (soft toggle, click on steps, physics bypass)
+selectHooks() points them at the matching variant whenever one of those changes, so a step only checks the state that changes mid-level
+*/
+class $modify(CBFGameLayer, GJBaseGameLayer) {
 	static void onModify(auto& self) {
 		(void) self.setHookPriority("GJBaseGameLayer::handleButton", Priority::VeryEarly);
 		(void) self.setHookPriority("GJBaseGameLayer::getModifiedDelta", Priority::VeryEarly);
 	}
 
 	// either use the modified delta to calculate the step count, or use the actual delta if physics bypass is enabled
+	template <bool Bypass, bool Disabled>
 	double calculateSteps(float modifiedDelta) {
-		PlayLayer* pl = PlayLayer::get();
+		PlayLayer* pl = frame.pl;
 		if (pl) {
 			const float timewarp = pl->m_gameState.m_timeWarp;
-			if (physicsBypass) {
-				if (softToggle) modifiedDelta = CCDirector::sharedDirector()->getActualDeltaTime() * timewarp;
-				else if (!firstFrame) modifiedDelta = (currentFrameTime - lastFrameTime) * timewarp;
+			if constexpr (Bypass) {
+				if constexpr (Disabled) modifiedDelta = CCDirector::sharedDirector()->getActualDeltaTime() * timewarp;
+				else if (!firstFrame) modifiedDelta = timestampToSeconds(currentFrameTime - lastFrameTime) * timewarp;
 			}
 
 			stepCount = calculateStepCount(modifiedDelta, timewarp, false);
+			if (Bypass && stepBudget.active()) { // the step count only gets patched in with physics bypass
+				if (firstFrame || pl->m_playerDied) stepBudget.clearBacklog();
+				double delta = modifiedDelta;
+				stepCount = stepBudget.schedule(stepCount, delta);
+				modifiedDelta = static_cast<float>(delta); // the steps stay the same length, what doesn't fit is simulated next frame
+				budgetedSteps = stepCount;
+				budgetedTime = 0;
+			}
 
-			if (pl->m_playerDied || GameManager::sharedState()->getEditorLayer() || softToggle) {
+			if (Disabled || pl->m_playerDied || GameManager::sharedState()->getEditorLayer()) {
 				skipUpdate = true;
 				firstFrame = true;
 			}
 			else if (modifiedDelta > 0.0) buildStepQueue(stepCount);
 			else skipUpdate = true;
 		}
-		else if (physicsBypass) stepCount = calculateStepCount(modifiedDelta, this->m_gameState.m_timeWarp, true); // disable physics bypass outside levels
+		else if constexpr (Bypass) stepCount = calculateStepCount(modifiedDelta, this->m_gameState.m_timeWarp, true); // disable physics bypass outside levels
 
 		return modifiedDelta;
 	}
 
-	void processCommands(float p0, bool p1, bool p2) {
-		if (clickOnSteps && !stepQueue.empty()) {
+	double calculateSteps(float modifiedDelta) {
+		return (this->*s_calculateSteps)(modifiedDelta);
+	}
+
+	template <bool ClickOnSteps>
+	void stepCommands(float p0, bool p1, bool p2) {
+		pollLateInputs(); // runs before each physics step
+		if (ClickOnSteps && !stepQueue.empty()) {
 			Step step;
 			do step = popStepQueue(); while (!stepQueue.empty() && !step.endStep); // process 1 step (or more if theres an input)
 		}
+		if (!budgetedSteps) {
+			GJBaseGameLayer::processCommands(p0, p1 ,p2);
+			return;
+		}
+
+		// time the physics step itself so the budget knows how many fit
+		TimestampType start = getCurrentTimestamp();
 		GJBaseGameLayer::processCommands(p0, p1 ,p2);
+		budgetedTime += getCurrentTimestamp() - start;
+	}
+
+	void processCommands(float p0, bool p1, bool p2) {
+		(this->*s_processCommands)(p0, p1, p2);
 	}
 
 	double getModifiedDelta(float delta) {
 		return calculateSteps(GJBaseGameLayer::getModifiedDelta(delta));
 	}
 
-#ifdef GEODE_IS_MACOS
-	// getModifiedDelta is inlined, hook update directly instead
 	void update(float delta) {
+#ifdef GEODE_IS_MACOS
+		// getModifiedDelta is inlined, calculate the steps here instead
 		if (this->m_started) {
 			float timewarp = std::max(this->m_gameState.m_timeWarp, 1.0f) / 240.0f;
 			calculateSteps(roundf((this->m_extraDelta + (m_resumeTimer <= 0 ? delta : 0.0)) / timewarp) * timewarp);
 		}
-
+#endif
 		GJBaseGameLayer::update(delta);
+
+		// calculateSteps ran somewhere above, processCommands timed each of the steps it allowed
+		if (budgetedSteps) {
+			stepBudget.recordCost(timestampToSeconds(budgetedTime), budgetedSteps);
+			budgetedSteps = 0;
+		}
 	}
-#endif
+
+	static inline double (CBFGameLayer::*s_calculateSteps)(float) = &CBFGameLayer::calculateSteps<false, false>;
+	static inline void (CBFGameLayer::*s_processCommands)(float, bool, bool) = &CBFGameLayer::stepCommands<false>;
 };
 
 CCPoint p1Pos = { 0.f, 0.f };
@@ -386,23 +577,31 @@ bool p1Split = false;
 bool p2Split = false;
 bool midStep = false;
 
-class $modify(PlayerObject) {
-	// split a single step based on the entries in stepQueue
-	void update(float stepDelta) {
-		PlayLayer* pl = PlayLayer::get();
+class $modify(CBFPlayerObject, PlayerObject) {
+	// split a single step based on the entries in stepQueue, Split is false when CBF is off or inputs are only applied on steps
+	template <bool Split>
+	void splitUpdate(float stepDelta) {
+		if constexpr (!Split) {
+			p1Split = false;
+			p2Split = false;
+			inputThisStep = false;
+			PlayerObject::update(stepDelta);
+			return;
+		}
+
+		PlayLayer* pl = frame.pl;
 		
-		if (pl && this != pl->m_player1 || midStep) { // do all of the logic during the P1 update for simplicity
-			if (midStep || !inputThisStep || this != pl->m_player2) PlayerObject::update(stepDelta);
+		if (pl && this != frame.p1 || midStep) { // do all of the logic during the P1 update for simplicity
+			if (midStep || !inputThisStep || this != frame.p2) PlayerObject::update(stepDelta);
 			return; 
 		}
 
-		inputThisStep = stepQueue.empty() ? false : !stepQueue.front().endStep;
-		if (!stepQueue.empty() && !inputThisStep && !clickOnSteps) stepQueue.pop_front();
+		inputThisStep = stepQueue.inputThisStep();
+		if (!inputThisStep) stepQueue.skipStep();
 		
 		if (skipUpdate
 			|| !pl
-			|| !inputThisStep
-			|| clickOnSteps)
+			|| !inputThisStep)
 		{
 			p1Split = false;
 			p2Split = false;
@@ -411,7 +610,7 @@ class $modify(PlayerObject) {
 			return;
 		}
 
-		PlayerObject* p2 = pl->m_player2;
+		PlayerObject* p2 = frame.p2;
 		bool isDual = pl->m_gameState.m_isDualMode;
 		bool p1StartedOnGround = this->m_isOnGround;
 		bool p2StartedOnGround = p2->m_isOnGround;
@@ -435,9 +634,12 @@ class $modify(PlayerObject) {
 		Step step;
 		bool firstLoop = true;
 		midStep = true;
+		ScopedCycles timer(flightRecorder.current().splitCycles);
 
 		do {
 			step = popStepQueue();
+			if (step.deltaFactor == 0.0f) continue; // coalesced, its input goes in together with the next one
+
 			const float substepDelta = stepDelta * step.deltaFactor;
 			rotationDelta = substepDelta;
 			
@@ -445,8 +647,8 @@ class $modify(PlayerObject) {
 				PlayerObject::update(substepDelta);
 				if (!step.endStep) {
 					if (firstLoop && ((this->m_yVelocity < 0) ^ this->m_isUpsideDown)) this->m_isOnGround = p1StartedOnGround; // this fixes delayed inputs on platforms moving down for some reason
-					if (!this->m_isOnSlope || this->m_isDart) pl->checkCollisions(this, 0.0f, true); // moving platforms will launch u really high if this is anything other than 0.0, idk why
-					else pl->checkCollisions(this, stepDelta, true); // slopes will launch you really high if the 2nd argument is lower than like 0.01, idk why
+					if (!this->m_isOnSlope || this->m_isDart) checkSplitCollisions(pl, this, 0.0f); // moving platforms will launch u really high if this is anything other than 0.0, idk why
+					else checkSplitCollisions(pl, this, stepDelta); // slopes will launch you really high if the 2nd argument is lower than like 0.01, idk why
 					PlayerObject::updateRotation(substepDelta);
 					decomp_resetCollisionLog(this); // necessary for wave
 				}
@@ -457,8 +659,8 @@ class $modify(PlayerObject) {
 				p2->update(substepDelta);
 				if (!step.endStep) {
 					if (firstLoop && ((p2->m_yVelocity < 0) ^ p2->m_isUpsideDown)) p2->m_isOnGround = p2StartedOnGround;
-					if (!p2->m_isOnSlope || p2->m_isDart) pl->checkCollisions(p2, 0.0f, true);
-					else pl->checkCollisions(p2, stepDelta, true);
+					if (!p2->m_isOnSlope || p2->m_isDart) checkSplitCollisions(pl, p2, 0.0f);
+					else checkSplitCollisions(pl, p2, stepDelta);
 					p2->updateRotation(substepDelta);
 					decomp_resetCollisionLog(p2);
 				}
@@ -471,37 +673,86 @@ class $modify(PlayerObject) {
 		midStep = false;
 	}
 
+	void update(float stepDelta) {
+		(this->*s_update)(stepDelta);
+	}
+
 	// this function was chosen to update m_lastPosition in just because it's called right at the end of the vanilla physics step loop
-	void updateRotation(float t) {
-		PlayLayer* pl = PlayLayer::get();
+	template <bool Bypass>
+	void splitUpdateRotation(float t) {
+		PlayLayer* pl = frame.pl;
 		
-		if (pl && this == pl->m_player1 && p1Split && !midStep) {
+		if (pl && this == frame.p1 && p1Split && !midStep) {
 			PlayerObject::updateRotation(rotationDelta); // perform the remaining rotation that was left incomplete in the PlayerObject::update() hook
 			this->m_lastPosition = p1Pos; // move triggers & spider get confused without this (iirc)
 		}
-		else if (pl && this == pl->m_player2 && p2Split && !midStep) {
+		else if (pl && this == frame.p2 && p2Split && !midStep) {
 			PlayerObject::updateRotation(rotationDelta);
 			this->m_lastPosition = p2Pos;
 		}
 		else PlayerObject::updateRotation(t);
 
-		if (physicsBypass && pl && !midStep) { // fix percent calculation with physics bypass on 2.2 levels
+		if (Bypass && pl && !midStep) { // fix percent calculation with physics bypass on 2.2 levels
 			pl->m_gameState.m_currentProgress = static_cast<int>(pl->m_gameState.m_levelTime * 240.0);
 		}
 	}
 
-	#ifdef GEODE_IS_WINDOWS
-	void updateShipRotation(float t) {
-		PlayLayer* pl = PlayLayer::get();
+	void updateRotation(float t) {
+		(this->*s_updateRotation)(t);
+	}
 
-		if (pl && (this == pl->m_player1 || this == pl->m_player2) && (physicsBypass || inputThisStep)) {
+	#ifdef GEODE_IS_WINDOWS
+	template <bool Bypass>
+	void splitUpdateShipRotation(float t) {
+		if (frame.pl && (this == frame.p1 || this == frame.p2) && (Bypass || inputThisStep)) {
 			shipRotDelta = t;
 			PlayerObject::updateShipRotation(1.0/1024); // necessary to use a really small deltatime to get around an oversight in rob's math
 			shipRotDelta = 0.0f;
 		}
 		else PlayerObject::updateShipRotation(t);
 	}
+
+	void updateShipRotation(float t) {
+		(this->*s_updateShipRotation)(t);
+	}
+
+	static inline void (CBFPlayerObject::*s_updateShipRotation)(float) = &CBFPlayerObject::splitUpdateShipRotation<false>;
 	#endif
+
+	static inline void (CBFPlayerObject::*s_update)(float) = &CBFPlayerObject::splitUpdate<true>;
+	static inline void (CBFPlayerObject::*s_updateRotation)(float) = &CBFPlayerObject::splitUpdateRotation<false>;
+};
+
+/*
+point the step hooks at the variants for the current settings
+*/
+void selectHooks() {
+	if (physicsBypass) {
+		CBFGameLayer::s_calculateSteps = softToggle ? &CBFGameLayer::calculateSteps<true, true> : &CBFGameLayer::calculateSteps<true, false>;
+		CBFPlayerObject::s_updateRotation = &CBFPlayerObject::splitUpdateRotation<true>;
+		#ifdef GEODE_IS_WINDOWS
+		CBFPlayerObject::s_updateShipRotation = &CBFPlayerObject::splitUpdateShipRotation<true>;
+		#endif
+	}
+	else {
+		CBFGameLayer::s_calculateSteps = softToggle ? &CBFGameLayer::calculateSteps<false, true> : &CBFGameLayer::calculateSteps<false, false>;
+		CBFPlayerObject::s_updateRotation = &CBFPlayerObject::splitUpdateRotation<false>;
+		#ifdef GEODE_IS_WINDOWS
+		CBFPlayerObject::s_updateShipRotation = &CBFPlayerObject::splitUpdateShipRotation<false>;
+		#endif
+	}
+
+	bool split = !softToggle && !clickOnSteps;
+	CBFGameLayer::s_processCommands = clickOnSteps && !softToggle ? &CBFGameLayer::stepCommands<true> : &CBFGameLayer::stepCommands<false>;
+	CBFPlayerObject::s_update = split ? &CBFPlayerObject::splitUpdate<true> : &CBFPlayerObject::splitUpdate<false>;
+}
+
+// pausing is the on demand trigger, right after something went wrong
+class $modify(PauseLayer) {
+	void customSetup() {
+		PauseLayer::customSetup();
+		if (dumpOnPause) dumpFlightRecorder(DumpReason::Manual);
+	}
 };
 
 /*
@@ -670,6 +921,7 @@ void togglePhysicsBypass(bool enable) {
 	}
 
 	physicsBypass = enable;
+	selectHooks();
 #endif
 }
 
@@ -688,6 +940,7 @@ void toggleMod(bool disable) {
 #endif
 
 	softToggle = disable;
+	selectHooks();
 
 	// for mod menus that let you toggle cbf mid-attempt
 	PlayLayer* pl = PlayLayer::get();
@@ -716,9 +969,26 @@ $on_mod(Loaded) {
 	togglePhysicsBypass(Mod::get()->getSettingValue<bool>("physics-bypass"));
 	listenForSettingChanges<bool>("physics-bypass", togglePhysicsBypass);
 
-	legacyBypass = Mod::get()->getSettingValue<std::string>("bypass-mode") == "2.1";
+	stepBudget.setBudget(Mod::get()->getSettingValue<double>("step-budget") / 1000.0);
+	listenForSettingChanges<double>("step-budget", +[](double budget) {
+		stepBudget.setBudget(budget / 1000.0);
+	});
+
+	stepQueue.setMinSubstep(Mod::get()->getSettingValue<double>("min-substep"));
+	listenForSettingChanges<double>("min-substep", +[](double fraction) {
+		stepQueue.setMinSubstep(fraction);
+	});
+
+	auto setFlightRecorder = +[](std::string mode) {
+		dumpOnDeath = mode != "off";
+		dumpOnPause = mode == "death, exit and pause";
+	};
+	setFlightRecorder(Mod::get()->getSettingValue<std::string>("flight-recorder"));
+	listenForSettingChanges<std::string>("flight-recorder", setFlightRecorder);
+
+	setBypassMode(Mod::get()->getSettingValue<std::string>("bypass-mode"));
 	listenForSettingChanges<std::string>("bypass-mode", +[](std::string mode) {
-		legacyBypass = mode == "2.1";
+		setBypassMode(mode);
 	});
 
 	safeMode = Mod::get()->getSettingValue<bool>("safe-mode");
@@ -727,8 +997,15 @@ $on_mod(Loaded) {
 	});
 
 	clickOnSteps = Mod::get()->getSettingValue<bool>("click-on-steps");
+	selectHooks();
 	listenForSettingChanges<bool>("click-on-steps", +[](bool enable) {
 		clickOnSteps = enable;
+		selectHooks();
+	});
+
+	lateInput = Mod::get()->getSettingValue<bool>("late-input");
+	listenForSettingChanges<bool>("late-input", +[](bool enable) {
+		lateInput = enable;
 	});
 
 	mouseFix = Mod::get()->getSettingValue<bool>("mouse-fix");
@@ -746,4 +1023,6 @@ $on_mod(Loaded) {
 
 	windowsSetup();
 #endif
+
+	inputLatency.setFrequency(timestampFrequency());
 }
\ No newline at end of file
@@ -2,12 +2,15 @@
 
 #include <Geode/platform/cplatform.h>
 
-using TimestampType = double;
+#include <cmath>
+
+#include "core/types.hpp"
 
 #ifdef GEODE_IS_WINDOWS
 
 #include "windows.hpp"
 
+// QPC ticks, or FILETIME on Linux (Wine's QPC frequency is the same 10MHz)
 inline TimestampType getCurrentTimestamp() {
 	LARGE_INTEGER t;
 	if (linuxNative) {
@@ -16,27 +19,48 @@ inline TimestampType getCurrentTimestamp() {
 	} else {
 		QueryPerformanceCounter(&t);
 	}
-	return static_cast<TimestampType>(t.QuadPart) / static_cast<TimestampType>(freq.QuadPart);
+	return t.QuadPart;
+}
+
+inline int64_t timestampFrequency() {
+	return freq.QuadPart;
 }
 
 #elif defined(GEODE_IS_ANDROID)
 
 #include <time.h>
 
+// ns
 inline TimestampType getCurrentTimestamp() {
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
-	// time as seconds
-	return (double)now.tv_sec + ((double)now.tv_nsec / 1'000'000'000.0);
+	return static_cast<TimestampType>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+inline int64_t timestampFrequency() {
+	return 1'000'000'000;
 }
 
 #elif defined(GEODE_IS_MACOS) || defined(GEODE_IS_IOS)
 
 #include <time.h>
 
+// ns
 inline TimestampType getCurrentTimestamp() {
-	// convert ns to seconds
-	return (double)clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1'000'000'000.0;
+	return static_cast<TimestampType>(clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+}
+
+inline int64_t timestampFrequency() {
+	return 1'000'000'000;
 }
 
 #endif
+
+// GD's own timestamps are seconds on the same clock
+inline TimestampType timestampFromSeconds(double seconds) {
+	return static_cast<TimestampType>(std::llround(seconds * static_cast<double>(timestampFrequency())));
+}
+
+inline double timestampToSeconds(TimestampType ticks) {
+	return static_cast<double>(ticks) / static_cast<double>(timestampFrequency());
+}
@@ -2,22 +2,15 @@
 
 #include <cstdint>
 #include <atomic>
+#include <bit>
+#include <chrono>
 
 LARGE_INTEGER freq;
 
-constexpr size_t RING_BUFFER_SIZE = 256;
-
-struct __attribute__((packed)) SharedMemory {
-	volatile uint32_t head;
-	volatile uint32_t tail;
-	volatile uint32_t error_flag;
-	volatile uint32_t heartbeat;
-	LinuxInputEvent events[RING_BUFFER_SIZE];
-};
-
 HANDLE hShmFile = NULL;
 HANDLE hShmMapping = NULL;
 SharedMemory* pSharedMem = nullptr;
+std::chrono::steady_clock::time_point linuxLaunchTime;
 
 // notify the player if theres an issue with input on Linux
 #include <Geode/modify/CreatorLayer.hpp>
@@ -25,11 +18,16 @@ class $modify(CreatorLayer) {
 	bool init() {
 		if (!CreatorLayer::init()) return false;
 
-		if (linuxNative && pSharedMem && pSharedMem->error_flag == 3 && !softToggle) {
-			log::error("Linux input failed");
+		if (!linuxNative || !pSharedMem || softToggle) return true;
+
+		uint32_t error = pSharedMem->error_flag.load(std::memory_order_relaxed);
+		if (error == LINUX_INPUT_NO_DEVICES || error == LINUX_INPUT_BAD_LAYOUT) {
+			log::error("Linux input failed: {}", error);
 			FLAlertLayer* popup = FLAlertLayer::create(
 				"CBF Linux",
-				"Failed to read input devices.\nOn most distributions, this can be resolved with the following command: <cr>sudo usermod -aG input $USER</c> (reboot afterward; this will make your system slightly less secure).\nIf the issue persists, please contact the mod developer.",
+				error == LINUX_INPUT_NO_DEVICES
+					? "Failed to read input devices.\nOn most distributions, this can be resolved with the following command: <cr>sudo usermod -aG input $USER</c> (reboot afterward; this will make your system slightly less secure).\nIf the issue persists, please contact the mod developer."
+					: "The Linux input program doesn't match this version of the mod.\nPlease reinstall the mod.",
 				"OK"
 			);
 			popup->m_scene = this;
@@ -39,174 +37,256 @@ class $modify(CreatorLayer) {
 	}
 };
 
+// the controller mapping never changes, only the actions do
+LinuxBinds linuxBinds = []() {
+	LinuxBinds binds;
+	binds.buttonKeys[BTN_A] = CONTROLLER_A;
+	binds.buttonKeys[BTN_B] = CONTROLLER_B;
+	binds.buttonKeys[BTN_X] = CONTROLLER_X;
+	binds.buttonKeys[BTN_Y] = CONTROLLER_Y;
+	binds.buttonKeys[BTN_TL] = CONTROLLER_LB;
+	binds.buttonKeys[BTN_TR] = CONTROLLER_RB;
+	binds.buttonKeys[BTN_SELECT] = CONTROLLER_Back;
+	binds.buttonKeys[BTN_START] = CONTROLLER_Start;
+
+	binds.axes[ABS_X] = { XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_LEFT, CONTROLLER_LTHUMBSTICK_RIGHT };
+	binds.axes[ABS_Y] = { XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_UP, CONTROLLER_LTHUMBSTICK_DOWN };
+	binds.axes[ABS_RX] = { XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_LEFT, CONTROLLER_RTHUMBSTICK_RIGHT };
+	binds.axes[ABS_RY] = { XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_UP, CONTROLLER_RTHUMBSTICK_DOWN };
+	binds.axes[ABS_HAT0X] = { 10, CONTROLLER_Left, CONTROLLER_Right };
+	binds.axes[ABS_HAT0Y] = { 10, CONTROLLER_Up, CONTROLLER_Down };
+	binds.axes[ABS_Z] = { XINPUT_GAMEPAD_TRIGGER_THRESHOLD, NO_KEY, CONTROLLER_LT };
+	binds.axes[ABS_RZ] = { XINPUT_GAMEPAD_TRIGGER_THRESHOLD, NO_KEY, CONTROLLER_RT };
+	return binds;
+}();
+
+// layout scanCodeActions was compiled for, linuxCheckInputs recompiles when it changes
+HKL linuxLayout = NULL;
+
+/*
+flatten inputBinds into direct lookup tables, so translating an event is a couple of array loads
+needs to be called after the keybinds change, and before linuxPublishBinds
+*/
+void linuxCompileBinds() {
+	linuxBinds.compileActions(inputBinds);
+	linuxBinds.rightClick = enableRightClick;
+
+	// keyboard events carry scancodes, translate them for the current layout once here
+	HKL layout = GetKeyboardLayout(0);
+	linuxLayout = layout;
+	auto compileScanCode = [&](uint16_t code) {
+		linuxBinds.scanCodeActions[shm_code_index(code)] = linuxBinds.actionFor(MapVirtualKeyExA(code, MAPVK_VSC_TO_VK, layout));
+	};
+	for (uint16_t code = 0; code <= KEY_MAX; code++) compileScanCode(code);
+	for (uint16_t code = 0xE000; code < 0xE100; code++) compileScanCode(code);
+}
+
+std::array<LinuxLatency, UNKNOWN + 1> linuxLatencies;
+
+const LinuxLatency& linuxLatency(DeviceType type) {
+	return linuxLatencies[type];
+}
+
+/*
+summary of where events spend their time between the kernel and GD
+kernel -> publish is linux-input's share, publish -> consume is waiting for the next frame to poll the ring
+*/
+void linuxLogLatency() {
+	static constexpr const char* deviceNames[] = { "mouse", "touchpad", "keyboard", "touchscreen", "controller", "unknown" };
+
+	for (int type = 0; type <= UNKNOWN; type++) {
+		const LinuxLatency& latency = linuxLatencies[type];
+		if (latency.kernelToPublish.count() == 0) continue;
+
+		auto us = [](uint64_t ns) { return ns / 1000.0; };
+		log::info(
+			"Linux input latency ({}, {} events): kernel->publish p50 {:.1f}us p99 {:.1f}us max {:.1f}us, publish->consume p50 {:.1f}us p99 {:.1f}us max {:.1f}us",
+			deviceNames[type], latency.kernelToPublish.count(),
+			us(latency.kernelToPublish.percentile(50)), us(latency.kernelToPublish.percentile(99)), us(latency.kernelToPublish.max()),
+			us(latency.publishToConsume.percentile(50)), us(latency.publishToConsume.percentile(99)), us(latency.publishToConsume.max())
+		);
+	}
+}
+
+/*
+true once linux-input has its devices open and is publishing events
+until then (or after it stops) GD's own input handling is used instead of the ring
+*/
+bool linuxInputReady() {
+	if (!pSharedMem) return false;
+
+	uint32_t state = pSharedMem->state.load(std::memory_order_acquire);
+
+	static uint32_t lastState = LINUX_INPUT_STARTING;
+	if (state != lastState) {
+		if (state == LINUX_INPUT_READY) {
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - linuxLaunchTime).count();
+			log::info(
+				"Linux input ready {:.1f}ms after launch ({} devices, map {:.1f}ms, probe {:.1f}ms, setup {:.1f}ms)",
+				ms, pSharedMem->device_count,
+				pSharedMem->startup_us[STARTUP_MAP] / 1000.0,
+				pSharedMem->startup_us[STARTUP_PROBE] / 1000.0,
+				pSharedMem->startup_us[STARTUP_SETUP] / 1000.0
+			);
+		}
+		else if (state == LINUX_INPUT_STOPPED) log::warn("Linux input program stopped, falling back to Wine input");
+		lastState = state;
+	}
+
+	return state == LINUX_INPUT_READY;
+}
+
 void linuxHeartbeat() {
-	if (pSharedMem) pSharedMem->heartbeat++;
+	if (pSharedMem) pSharedMem->heartbeat.store(pSharedMem->heartbeat.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 }
 
-void linuxCheckInputs() {
+/*
+tell linux-input which codes are bound so it can drop everything else before it reaches the ring
+needs to be called after the keybinds change
+*/
+void linuxPublishBinds() {
 	if (!pSharedMem) return;
 
-	static std::unordered_map<int, enumKeyCodes> linuxToCCKey = {
-		{ BTN_A, CONTROLLER_A },
-		{ BTN_B, CONTROLLER_B },
-		{ BTN_X, CONTROLLER_X },
-		{ BTN_Y, CONTROLLER_Y },
-		{ BTN_TL, CONTROLLER_LB },
-		{ BTN_TR, CONTROLLER_RB },
-		{ BTN_SELECT, CONTROLLER_Back },
-		{ BTN_START, CONTROLLER_Start },
+	std::array<uint32_t, SHM_CODE_COUNT / 32> bitmap{};
+	auto setBit = [&](uint16_t code) {
+		uint32_t index = shm_code_index(code);
+		if (index < SHM_CODE_COUNT) bitmap[index / 32] |= 1u << (index % 32);
 	};
 
-	uint32_t h = pSharedMem->head;
-	std::atomic_thread_fence(std::memory_order_acquire);
-	uint32_t t = pSharedMem->tail;
+	// keyboard events carry scancodes, which linuxCompileBinds already translated for the current layout
+	for (uint16_t code = 0; code <= KEY_MAX; code++) {
+		if (linuxBinds.scanCodeActions[code] != UNBOUND) setBit(code);
+	}
+	for (uint16_t code = 0xE000; code < 0xE100; code++) {
+		if (linuxBinds.scanCodeActions[shm_code_index(code)] != UNBOUND) setBit(code);
+	}
+
+	setBit(BUTTON_LEFT);
+	if (enableRightClick) setBit(BUTTON_RIGHT);
+	setBit(BTN_TOUCH);
+	for (uint16_t code = 0; code <= KEY_MAX; code++) {
+		int16_t keyCode = linuxBinds.buttonKeys[code];
+		if (keyCode != NO_KEY && linuxBinds.actionFor(keyCode) != UNBOUND) setBit(code);
+	}
+
+	pSharedMem->left_stick_deadzone.store(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, std::memory_order_relaxed);
+	pSharedMem->right_stick_deadzone.store(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, std::memory_order_relaxed);
+	pSharedMem->hat_deadzone.store(10, std::memory_order_relaxed);
+	pSharedMem->trigger_threshold.store(XINPUT_GAMEPAD_TRIGGER_THRESHOLD, std::memory_order_relaxed);
+	for (size_t i = 0; i < bitmap.size(); i++) {
+		pSharedMem->bound_codes[i].store(bitmap[i], std::memory_order_relaxed);
+	}
+	pSharedMem->filter_active.store(1, std::memory_order_release);
+}
+
+/*
+only forward input while a level is actually being played
+*/
+void linuxSetArmed(bool armed) {
+	if (!pSharedMem) return;
+
+	bool wasArmed = pSharedMem->armed.load(std::memory_order_relaxed);
+	if (armed == wasArmed) return;
+
+	pSharedMem->armed.store(armed, std::memory_order_relaxed);
+	// releases get dropped while disarmed, so don't trust the old held state
+	if (armed) linuxBinds.held.reset();
+}
+
+/*
+read the latest (monotonic, realtime) pair published by linux-input
+returns false if it hasn't published one yet
+*/
+bool readClockCalibration(int64_t& monotonic, int64_t& realtime) {
+	uint32_t seq;
+	do {
+		seq = pSharedMem->clock_seq.load(std::memory_order_acquire);
+		monotonic = pSharedMem->clock_monotonic.load(std::memory_order_relaxed);
+		realtime = pSharedMem->clock_realtime.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != pSharedMem->clock_seq.load(std::memory_order_relaxed));
+
+	return seq != 0;
+}
+
+// whether linux-input has published anything linuxCheckInputs hasn't read yet
+bool linuxInputPending() {
+	return pSharedMem && pSharedMem->head.load(std::memory_order_relaxed) != pSharedMem->tail.load(std::memory_order_relaxed);
+}
+
+void linuxCheckInputs() {
+	if (!pSharedMem) return;
+
+	// the layout can be switched in the middle of a level, the scancode tables and the filter have to follow it
+	if (GetKeyboardLayout(0) != linuxLayout) {
+		log::info("Keyboard layout changed, recompiling Linux keybinds");
+		linuxCompileBinds();
+		linuxPublishBinds();
+	}
+
+	// event timestamps are CLOCK_MONOTONIC, convert them to the FILETIME domain used for frame times
+	int64_t calMonotonic, calRealtime;
+	if (!readClockCalibration(calMonotonic, calRealtime)) return;
+
+	// report when the realtime clock gets stepped or slewed relative to the monotonic one
+	static int64_t lastClockOffset = 0;
+	int64_t clockOffset = calRealtime - calMonotonic / 100;
+	if (lastClockOffset != 0 && std::abs(clockOffset - lastClockOffset) > 10000) {
+		log::warn("Realtime clock skewed by {}ms relative to monotonic", (clockOffset - lastClockOffset) / 10000.0);
+	}
+	lastClockOffset = clockOffset;
+
+	static uint32_t lastRtStatus = 0;
+	uint32_t rtStatus = pSharedMem->rt_status.load(std::memory_order_relaxed);
+	if (rtStatus != lastRtStatus) {
+		log::info(
+			"Linux input real-time mode: fifo {} rr {} nice {} mlock {} prefault {} affinity {}",
+			(rtStatus & RT_SCHED_FIFO) != 0,
+			(rtStatus & RT_SCHED_RR) != 0,
+			(rtStatus & RT_NICE) != 0,
+			(rtStatus & RT_MLOCK) != 0,
+			(rtStatus & RT_PREFAULT) != 0,
+			(rtStatus & RT_AFFINITY) != 0
+		);
+		lastRtStatus = rtStatus;
+	}
+
+	static uint32_t lastDropped = 0;
+	uint32_t dropped = pSharedMem->dropped.load(std::memory_order_relaxed);
+	if (dropped != lastDropped) {
+		log::warn("Linux input buffer full, dropped {} events", dropped - lastDropped);
+		lastDropped = dropped;
+	}
+
+	const LinuxInputEvent* slots = shm_slots(pSharedMem);
+	const uint32_t mask = pSharedMem->capacity - 1;
+	uint32_t h = pSharedMem->head.load(std::memory_order_acquire);
+	uint32_t t = pSharedMem->tail.load(std::memory_order_relaxed);
+
+	// dequeue time in linux-input's monotonic domain, to compare against the publish times
+	LARGE_INTEGER now;
+	GetSystemTimePreciseAsFileTime((FILETIME*)&now);
+	int64_t consumed = calMonotonic + (now.QuadPart - calRealtime) * 100;
 
 	while (t != h) {
-		const LinuxInputEvent& ev = pSharedMem->events[t & (RING_BUFFER_SIZE - 1)];
+		const LinuxInputEvent& ev = slots[t & mask];
 		t++;
 
-		PlayerButtonCommand input;
-		bool player1 = true;
-		USHORT scanCode = ev.code;
-		int value = ev.value;
-
-		switch (ev.deviceType) {
-		case MOUSE:
-		case TOUCHPAD:
-			if (scanCode == BUTTON_LEFT) {
-				input.m_button = PlayerButton::Jump;
-			}
-			else if (scanCode == BUTTON_RIGHT) {
-				if (!enableRightClick) continue;
-				input.m_button = PlayerButton::Jump;
-				player1 = false;
-			}
-			break;
-		case KEYBOARD: {
-			USHORT keyCode = MapVirtualKeyExA(scanCode, MAPVK_VSC_TO_VK, GetKeyboardLayout(0));
-			if (inputBinds[p1Jump].contains(keyCode)) input.m_button = PlayerButton::Jump;
-			else if (inputBinds[p1Left].contains(keyCode)) input.m_button = PlayerButton::Left;
-			else if (inputBinds[p1Right].contains(keyCode)) input.m_button = PlayerButton::Right;
-			else {
-				player1 = false;
-				if (inputBinds[p2Jump].contains(keyCode)) input.m_button = PlayerButton::Jump;
-				else if (inputBinds[p2Left].contains(keyCode)) input.m_button = PlayerButton::Left;
-				else if (inputBinds[p2Right].contains(keyCode)) input.m_button = PlayerButton::Right;
-				else continue;
-			}
-			break;
-		}
-		case TOUCHSCREEN:
-			if (scanCode == BTN_TOUCH) {
-				input.m_button = PlayerButton::Jump;
-			}
-			break;
-		case CONTROLLER: {
-			int keyCode = -1;
-			if (ev.type == EV_KEY) {
-				keyCode = linuxToCCKey[scanCode];
-			} else if (ev.type == EV_ABS) {
-				bool continueLoop = false;
-				auto analyze4Directions = [&] (int deadzone, enumKeyCodes negative, enumKeyCodes positive) {
-					if (ev.value < -deadzone) {
-						keyCode = negative;
-						if (heldInputs.contains(negative)) {
-							continueLoop = true;
-						}
-						value = Press;
-					} else if (ev.value > deadzone) {
-						keyCode = positive;
-						if (heldInputs.contains(positive)) {
-							continueLoop = true;
-						}
-						value = Press;
-					} else {
-						value = Release;
-						if (heldInputs.contains(negative)) {
-							keyCode = negative;
-						} else if (heldInputs.contains(positive)) {
-							keyCode = positive;
-						} else {
-							continueLoop = true;
-						}
-					}
-				};
-
-				switch (ev.code) {
-				case ABS_X:
-					analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_LEFT, CONTROLLER_LTHUMBSTICK_RIGHT);
-					break;
-				case ABS_Y:
-					analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_UP, CONTROLLER_LTHUMBSTICK_DOWN);
-					break;
-				case ABS_RX:
-					analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_LEFT, CONTROLLER_RTHUMBSTICK_RIGHT);
-					break;
-				case ABS_RY:
-					analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_UP, CONTROLLER_RTHUMBSTICK_DOWN);
-					break;
-				case ABS_HAT0X:
-					analyze4Directions(10, CONTROLLER_Left, CONTROLLER_Right);
-					break;
-				case ABS_HAT0Y:
-					analyze4Directions(10, CONTROLLER_Up, CONTROLLER_Down);
-					break;
-				case ABS_Z:
-					keyCode = CONTROLLER_LT;
-					if (ev.value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
-						value = Press;
-					} else {
-						value = Release;
-					}
-					break;
-				case ABS_RZ:
-					keyCode = CONTROLLER_RT;
-					if (ev.value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
-						value = Press;
-					} else {
-						value = Release;
-					}
-					break;
-				}
-				if (continueLoop) continue;
-			}
-			if (inputBinds[p1Jump].contains(keyCode)) input.m_button = PlayerButton::Jump;
-			else if (inputBinds[p1Left].contains(keyCode)) input.m_button = PlayerButton::Left;
-			else if (inputBinds[p1Right].contains(keyCode)) input.m_button = PlayerButton::Right;
-			else {
-				player1 = false;
-				if (inputBinds[p2Jump].contains(keyCode)) input.m_button = PlayerButton::Jump;
-				else if (inputBinds[p2Left].contains(keyCode)) input.m_button = PlayerButton::Left;
-				else if (inputBinds[p2Right].contains(keyCode)) input.m_button = PlayerButton::Right;
-				else continue;
-			}
-			if (value == Press) {
-				if (heldInputs.contains(keyCode)) {
-					continue;
-				} else {
-					heldInputs.emplace(keyCode);
-				}
-			} else {
-				if (!heldInputs.contains(keyCode)) {
-					continue;
-				} else {
-					heldInputs.erase(keyCode);
-				}
-			}
-			break;
-		}
-		default:
-			continue;
+		if (ev.deviceType >= 0 && ev.deviceType <= UNKNOWN) {
+			LinuxLatency& latency = linuxLatencies[ev.deviceType];
+			latency.kernelToPublish.record(ev.published - ev.time);
+			latency.publishToConsume.record(consumed - ev.published);
 		}
 
-		input.m_isPush = value;
-		input.m_timestamp = (double)ev.time.QuadPart / (double)freq.QuadPart;
-		input.m_isPlayer2 = !player1;
+		StepInput input;
+		if (!linuxBinds.translate(ev, input)) continue;
+		input.timestamp = calRealtime + (ev.time - calMonotonic) / 100; // ns -> FILETIME ticks
+		input.source = SOURCE_LINUX;
 
 		inputVector.emplace_back(input);
 	}
 
-	pSharedMem->tail = t;
+	pSharedMem->tail.store(t, std::memory_order_release);
 }
 
 void windowsSetup() {
@@ -239,12 +319,16 @@ void windowsSetup() {
 				return;
 			}
 
+			uint32_t capacity = std::bit_ceil(static_cast<uint32_t>(std::clamp<int64_t>(
+				Mod::get()->getSettingValue<int64_t>("ring-buffer-size"), SHM_MIN_CAPACITY, SHM_MAX_CAPACITY)));
+			size_t shmSize = shm_size(capacity);
+
 			LARGE_INTEGER fileSize;
-			fileSize.QuadPart = sizeof(SharedMemory);
+			fileSize.QuadPart = shmSize;
 			SetFilePointerEx(hShmFile, fileSize, NULL, FILE_BEGIN);
 			SetEndOfFile(hShmFile);
 
-			hShmMapping = CreateFileMapping(hShmFile, NULL, PAGE_READWRITE, 0, sizeof(SharedMemory), NULL);
+			hShmMapping = CreateFileMapping(hShmFile, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(shmSize), NULL);
 			if (!hShmMapping) {
 				log::error("Failed to create file mapping: {}", GetLastError());
 				CloseHandle(hShmFile);
@@ -252,7 +336,7 @@ void windowsSetup() {
 			}
 
 			pSharedMem = static_cast<SharedMemory*>(
-				MapViewOfFile(hShmMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMemory)));
+				MapViewOfFile(hShmMapping, FILE_MAP_ALL_ACCESS, 0, 0, shmSize));
 			if (!pSharedMem) {
 				log::error("Failed to map view: {}", GetLastError());
 				CloseHandle(hShmMapping);
@@ -260,7 +344,12 @@ void windowsSetup() {
 				return;
 			}
 
-			ZeroMemory(pSharedMem, sizeof(SharedMemory));
+			ZeroMemory(pSharedMem, shmSize);
+			pSharedMem->magic = SHM_MAGIC;
+			pSharedMem->version = SHM_VERSION;
+			pSharedMem->capacity = capacity;
+			pSharedMem->slot_size = sizeof(LinuxInputEvent);
+			log::info("Linux input buffer: {} events", capacity);
 
 			std::string path = CCFileUtils::get()->fullPathForFilename("linux-input.so"_spr, true);
 
@@ -295,8 +384,39 @@ void windowsSetup() {
 			si.cb = sizeof(si);
 			ZeroMemory(&pi, sizeof(pi));
 
+			std::string args;
+			if (Mod::get()->getSettingValue<bool>("linux-realtime")) {
+				args += " --realtime";
+
+				// only pass through characters that can appear in a cpu list, this ends up in a shell command
+				std::string cpus = Mod::get()->getSettingValue<std::string>("linux-cpu-affinity");
+				std::erase_if(cpus, [](char c) { return !std::isdigit(static_cast<unsigned char>(c)) && c != ',' && c != '-'; });
+				if (!cpus.empty()) args += " --cpus " + cpus;
+			}
+			if (Mod::get()->getSettingValue<bool>("linux-io-uring")) args += " --io-uring";
+
+			// extra options for development, e.g. --record/--replay to capture or feed back a trace of inputs
+			// split on whitespace and single quoted one by one like the paths, so nothing in them reaches the shell
+			if (const char* extraArgs = std::getenv("CBF_LINUX_INPUT_ARGS")) {
+				std::string_view extra = extraArgs;
+				if (extra.find_first_of("'\"") != std::string_view::npos) {
+					log::warn("Ignoring CBF_LINUX_INPUT_ARGS, it can't contain quotes");
+				}
+				else {
+					size_t pos = 0;
+					while ((pos = extra.find_first_not_of(" \t\r\n", pos)) != std::string_view::npos) {
+						size_t end = extra.find_first_of(" \t\r\n", pos);
+						if (end == std::string_view::npos) end = extra.size();
+						args += " '";
+						args += extra.substr(pos, end - pos);
+						args += "'";
+						pos = end;
+					}
+				}
+			}
+
 			std::string cmdline = std::string("/bin/sh -c \"chmod +x '") + unixBinPath
-				+ "' && exec '" + unixBinPath + "' '" + unixShmPath + "'\"";
+				+ "' && exec '" + unixBinPath + "' '" + unixShmPath + "'" + args + "\"";
 
 			if (!CreateProcess("Z:\\bin\\sh", (LPSTR)cmdline.c_str(), NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
 				log::error("Failed to launch Linux input program: {}", GetLastError());
@@ -307,6 +427,7 @@ void windowsSetup() {
 				return;
 			}
 
+			linuxLaunchTime = std::chrono::steady_clock::now();
 			CloseHandle(pi.hProcess);
 			CloseHandle(pi.hThread);
 		}
@@ -2,23 +2,9 @@
 
 #include <Geode/Geode.hpp>
 #include "linuxeventcodes.hpp"
-
-enum DeviceType : int8_t {
-    MOUSE,
-    TOUCHPAD,
-    KEYBOARD,
-    TOUCHSCREEN,
-    CONTROLLER,
-    UNKNOWN
-};
-
-struct __attribute__((packed)) LinuxInputEvent {
-    LARGE_INTEGER time;
-    USHORT type;
-    USHORT code;
-    int value;
-    DeviceType deviceType;
-};
+#include "linuxshm.hpp"
+#include "core/histogram.hpp"
+#include "core/linuxbinds.hpp"
 
 extern LARGE_INTEGER freq;
 
@@ -26,4 +12,18 @@ extern bool linuxNative;
 
 void windowsSetup();
 void linuxCheckInputs();
+bool linuxInputPending();
+bool linuxInputReady();
 void linuxHeartbeat();
+void linuxCompileBinds();
+void linuxPublishBinds();
+void linuxSetArmed(bool armed);
+
+// per device type, in ns
+struct LinuxLatency {
+	LatencyHistogram kernelToPublish; // evdev timestamp -> linux-input publishing it
+	LatencyHistogram publishToConsume; // publishing -> linuxCheckInputs dequeuing it
+};
+
+const LinuxLatency& linuxLatency(DeviceType type);
+void linuxLogLatency();